@@ -0,0 +1,265 @@
+/**********************************************************************
+* Copyright (C) 2018 - tx7do - All Rights Reserved
+*
+* ļ:		SerializedPhpCache.cpp
+* ժ    Ҫ:		ݻ
+*
+*     :		yanglinbo,
+*     :		鿴ļ·.
+*
+***********************************************************************/
+
+#include "SerializedPhpCache.h"
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+
+// XXH64
+static const uint64 kPrime64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64 kPrime64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64 kPrime64_3 = 0x165667B19E3779F9ULL;
+static const uint64 kPrime64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64 kPrime64_5 = 0x27D4EB2F165667C5ULL;
+
+static inline uint64 rotateLeft(uint64 nValue, int32 nBits)
+{
+	return (nValue << nBits) | (nValue >> (64 - nBits));
+}
+
+static inline uint64 read64(const char* p)
+{
+	uint64 nValue;
+	memcpy(&nValue, p, sizeof(nValue));
+	return nValue;
+}
+
+static inline uint32 read32(const char* p)
+{
+	uint32 nValue;
+	memcpy(&nValue, p, sizeof(nValue));
+	return nValue;
+}
+
+static inline uint64 hashRound(uint64 nAcc, uint64 nInput)
+{
+	nAcc += nInput * kPrime64_2;
+	nAcc = rotateLeft(nAcc, 31);
+	return nAcc * kPrime64_1;
+}
+
+static inline uint64 hashMerge(uint64 nAcc, uint64 nValue)
+{
+	nAcc ^= hashRound(0, nValue);
+	return nAcc * kPrime64_1 + kPrime64_4;
+}
+
+uint64 SerializedPhpCache::hash(const char* pData, size_t nLength)
+{
+	const char* p = pData;
+	const char* pEnd = pData + nLength;
+	uint64 h = 0;
+	if (nLength >= 32)
+	{
+		uint64 v1 = kPrime64_1 + kPrime64_2;
+		uint64 v2 = kPrime64_2;
+		uint64 v3 = 0;
+		uint64 v4 = 0 - kPrime64_1;
+		const char* pLimit = pEnd - 32;
+		do
+		{
+			v1 = hashRound(v1, read64(p));
+			v2 = hashRound(v2, read64(p + 8));
+			v3 = hashRound(v3, read64(p + 16));
+			v4 = hashRound(v4, read64(p + 24));
+			p += 32;
+		} while (p <= pLimit);
+		h = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+		h = hashMerge(h, v1);
+		h = hashMerge(h, v2);
+		h = hashMerge(h, v3);
+		h = hashMerge(h, v4);
+	}
+	else
+	{
+		h = kPrime64_5;
+	}
+	h += nLength;
+
+	for (; p + 8 <= pEnd; p += 8)
+	{
+		h ^= hashRound(0, read64(p));
+		h = rotateLeft(h, 27) * kPrime64_1 + kPrime64_4;
+	}
+	if (p + 4 <= pEnd)
+	{
+		h ^= uint64(read32(p)) * kPrime64_1;
+		h = rotateLeft(h, 23) * kPrime64_2 + kPrime64_3;
+		p += 4;
+	}
+	for (; p < pEnd; p++)
+	{
+		h ^= uint8(*p) * kPrime64_5;
+		h = rotateLeft(h, 11) * kPrime64_1;
+	}
+
+	h ^= h >> 33;
+	h *= kPrime64_2;
+	h ^= h >> 29;
+	h *= kPrime64_3;
+	h ^= h >> 32;
+	return h;
+}
+
+//////////////////////////////////////////////////////////////////////////
+struct SerializedPhpCache::Shard
+{
+	struct Entry
+	{
+		uint64 nHash;
+		String strInput;		///< ʱȽ, ϣײشĽ
+		SerializedDocument document;
+		size_t nBytes;
+	};
+	typedef std::list<Entry> EntryList;
+	/// ϣֻͬһ
+	typedef std::unordered_map<uint64, EntryList::iterator> EntryMap;
+
+	Shard() : nHits(0), nMisses(0), nEvictions(0), nBytes(0) {}
+
+	bool find(uint64 nHash, const char* pData, int32 nLength, SerializedDocument& document);
+	void insert(uint64 nHash, const char* pData, int32 nLength, const SerializedDocument& document, size_t nBytes, size_t nMaxBytes);
+	void erase(EntryList::iterator it);
+
+	mutable std::mutex mutex;
+	EntryList lru;			///< ͷΪʹ
+	EntryMap entries;
+	uint64 nHits;
+	uint64 nMisses;
+	uint64 nEvictions;
+	size_t nBytes;
+};
+
+bool SerializedPhpCache::Shard::find(uint64 nHash, const char* pData, int32 nLength, SerializedDocument& document)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	EntryMap::iterator it = entries.find(nHash);
+	if (it == entries.end() || it->second->strInput.length() != size_t(nLength)
+		|| memcmp(it->second->strInput.data(), pData, nLength) != 0)
+	{
+		nMisses++;
+		return false;
+	}
+	lru.splice(lru.begin(), lru, it->second);
+	document = it->second->document;
+	nHits++;
+	return true;
+}
+
+void SerializedPhpCache::Shard::insert(uint64 nHash, const char* pData, int32 nLength, const SerializedDocument& document, size_t nBytes, size_t nMaxBytes)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	// ߳̿ѷͬһ, ˹ϣͬһ, ½Ϊ׼
+	EntryMap::iterator it = entries.find(nHash);
+	if (it != entries.end())
+	{
+		erase(it->second);
+	}
+	while (!lru.empty() && this->nBytes + nBytes > nMaxBytes)
+	{
+		erase(--lru.end());
+		nEvictions++;
+	}
+	Entry entry;
+	entry.nHash = nHash;
+	entry.strInput.assign(pData, nLength);
+	entry.document = document;
+	entry.nBytes = nBytes;
+	lru.push_front(entry);
+	entries[nHash] = lru.begin();
+	this->nBytes += nBytes;
+}
+
+void SerializedPhpCache::Shard::erase(EntryList::iterator it)
+{
+	nBytes -= it->nBytes;
+	entries.erase(it->nHash);
+	lru.erase(it);
+}
+
+//////////////////////////////////////////////////////////////////////////
+SerializedPhpCache::SerializedPhpCache(size_t nMaxBytes, uint32 nShards)
+{
+	uint32 nCount = 1;
+	while (nCount < nShards)
+	{
+		nCount <<= 1;
+	}
+	m_pShards = new Shard[nCount];
+	m_nMask = nCount - 1;
+	m_nShardBytes = nMaxBytes / nCount;
+}
+
+SerializedPhpCache::~SerializedPhpCache()
+{
+	delete[] m_pShards;
+}
+
+SerializedDocument SerializedPhpCache::parse(const String& strInput)
+{
+	return parse(strInput.data(), int32(strInput.length()));
+}
+
+SerializedDocument SerializedPhpCache::parse(const char* pData, int32 nLength)
+{
+	uint64 nHash = hash(pData, nLength);
+	// Ƭøλ, Ƭڵıϣ
+	Shard& shard = m_pShards[uint32(nHash >> 32) & m_nMask];
+	SerializedDocument document;
+	if (shard.find(nHash, pData, nLength, document))
+	{
+		return document;
+	}
+
+	SerializedPhpParser parser(String(pData, nLength));
+	document = parser.parse().freeze();
+
+	//  + ڵ + 븱 + ڵ
+	size_t nBytes = document.root().memoryUsage() + sizeof(SerializedValue) + size_t(nLength)
+		+ sizeof(Shard::Entry) + 6 * sizeof(void*);
+	if (nBytes <= m_nShardBytes)
+	{
+		shard.insert(nHash, pData, nLength, document, nBytes, m_nShardBytes);
+	}
+	return document;
+}
+
+void SerializedPhpCache::clear()
+{
+	for (uint32 i = 0; i <= m_nMask; i++)
+	{
+		Shard& shard = m_pShards[i];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.entries.clear();
+		shard.lru.clear();
+		shard.nBytes = 0;
+	}
+}
+
+SerializedCacheStatistics SerializedPhpCache::statistics() const
+{
+	SerializedCacheStatistics statistics;
+	memset(&statistics, 0, sizeof(statistics));
+	for (uint32 i = 0; i <= m_nMask; i++)
+	{
+		const Shard& shard = m_pShards[i];
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		statistics.nHits += shard.nHits;
+		statistics.nMisses += shard.nMisses;
+		statistics.nEvictions += shard.nEvictions;
+		statistics.nEntries += shard.entries.size();
+		statistics.nBytes += shard.nBytes;
+	}
+	return statistics;
+}
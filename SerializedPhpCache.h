@@ -0,0 +1,67 @@
+/**********************************************************************
+* Copyright (C) 2018 - tx7do - All Rights Reserved
+*
+* ļ:		SerializedPhpCache.h
+* ժ    Ҫ:		ݻ
+*
+*     :		yanglinbo,
+*     :		鿴ļ·.
+*
+***********************************************************************/
+
+#ifndef __SerializedPhpCache_H__
+#define __SerializedPhpCache_H__
+
+#include "SerializedPhpParser.h"
+
+
+/// ļ
+struct SerializedCacheStatistics
+{
+	uint64 nHits;
+	uint64 nMisses;
+	uint64 nEvictions;
+	size_t nEntries;
+	size_t nBytes;			///< е븱ֽ
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// 
+/// 64λϣ(XXH64)Ϊ, ʱٱȽֽ, عֻĵ;
+/// δʱSerializedPhpParser::parse()freeze()뻺.
+/// ϣƬ, ÿƬһһLRU, .
+/// ڴްSerializedValue::memoryUsage()ͳƵʵʴСֵƬ, ʱ̭δõ,
+/// һƬʱ.
+//////////////////////////////////////////////////////////////////////////
+class SerializedPhpCache
+{
+public:
+	/// nShardsȡΪ2
+	SerializedPhpCache(size_t nMaxBytes = 64 << 20, uint32 nShards = 16);
+	~SerializedPhpCache();
+
+public:
+	SerializedDocument parse(const char* pData, int32 nLength);
+	SerializedDocument parse(const String& strInput);
+
+	void clear();
+
+	SerializedCacheStatistics statistics() const;
+
+	/// ʹõĹϣ
+	static uint64 hash(const char* pData, size_t nLength);
+
+private:
+	SerializedPhpCache(const SerializedPhpCache&);
+	SerializedPhpCache& operator=(const SerializedPhpCache&);
+
+	struct Shard;
+
+private:
+	Shard*		m_pShards;
+	uint32		m_nMask;
+	size_t		m_nShardBytes;
+};
+
+
+#endif
@@ -0,0 +1,439 @@
+/**********************************************************************
+* Copyright (C) 2018 - tx7do - All Rights Reserved
+*
+* ļ:		SerializedPhpColumns.cpp
+* ժ    Ҫ:		ѽṹͬļ¼鰴н
+*
+*     :		yanglinbo,
+*     :		鿴ļ·.
+*
+***********************************************************************/
+
+#include "SerializedPhpColumns.h"
+
+
+SerializedColumn::SerializedColumn(const String& strName, SerializedValueType type)
+	: m_strName(strName)
+	, m_type(type)
+	, m_bFixedType(type != nullValue)
+{
+}
+
+void SerializedColumn::reserve(int32 nRows)
+{
+	m_arrValidity.reserve((nRows + 7) / 8);
+	switch (m_type)
+	{
+	case intValue:
+	case booleanValue:
+		m_arrInts.reserve(nRows);
+		break;
+	case realValue:
+		m_arrDoubles.reserve(nRows);
+		break;
+	case stringValue:
+		m_arrOffsets.reserve(nRows + 1);
+		break;
+	default:
+		break;
+	}
+}
+
+void SerializedColumn::clear()
+{
+	if (!m_bFixedType)
+	{
+		m_type = nullValue;
+	}
+	m_arrValidity.clear();
+	m_arrInts.clear();
+	m_arrDoubles.clear();
+	m_arrOffsets.clear();
+	m_strBytes.clear();
+}
+
+void SerializedColumn::fill(int32 nRows)
+{
+	m_arrValidity.resize((nRows + 7) / 8);
+	switch (m_type)
+	{
+	case intValue:
+	case booleanValue:
+		m_arrInts.resize(nRows);
+		break;
+	case realValue:
+		m_arrDoubles.resize(nRows);
+		break;
+	case stringValue:
+		// ЧΪմ, ƫһеĽβͬ
+		m_arrOffsets.resize(nRows + 1, uint32(m_strBytes.length()));
+		break;
+	default:
+		break;
+	}
+}
+
+void SerializedColumn::truncate(int32 nRows)
+{
+	m_arrValidity.resize((nRows + 7) / 8);
+	if (nRows & 7)
+	{
+		m_arrValidity.back() &= uint8((1 << (nRows & 7)) - 1);
+	}
+	bool bAnyValid = false;
+	for (size_t i = 0; i < m_arrValidity.size() && !bAnyValid; i++)
+	{
+		bAnyValid = m_arrValidity[i] != 0;
+	}
+	if (!m_bFixedType && !bAnyValid)
+	{
+		// ʣµжЧʱԱ, ָΪδ
+		m_type = nullValue;
+		m_arrInts.clear();
+		m_arrDoubles.clear();
+		m_arrOffsets.clear();
+		m_strBytes.clear();
+		return;
+	}
+	switch (m_type)
+	{
+	case intValue:
+	case booleanValue:
+		if (m_arrInts.size() > size_t(nRows))
+			m_arrInts.resize(nRows);
+		break;
+	case realValue:
+		if (m_arrDoubles.size() > size_t(nRows))
+			m_arrDoubles.resize(nRows);
+		break;
+	case stringValue:
+		// offsets()[nRows]Ǳпʼǰֽ
+		if (m_arrOffsets.size() > size_t(nRows))
+		{
+			m_strBytes.resize(m_arrOffsets[nRows]);
+			m_arrOffsets.resize(nRows + 1);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+bool SerializedColumn::setInt(int32 nRow, int64 nValue, SerializedValueType type)
+{
+	if (m_type == nullValue)
+	{
+		m_type = type;
+	}
+	if (m_type == realValue && type == intValue)
+	{
+		return setDouble(nRow, double(nValue));
+	}
+	if (m_type != type || hasValue(nRow))
+	{
+		return false;
+	}
+	fill(nRow + 1);
+	m_arrInts[nRow] = nValue;
+	setValid(nRow);
+	return true;
+}
+
+bool SerializedColumn::setDouble(int32 nRow, double fValue)
+{
+	if (m_type == nullValue)
+	{
+		m_type = realValue;
+	}
+	else if (m_type == intValue && !m_bFixedType)
+	{
+		// Զ͵ʱΪ, ֮ǰתΪ
+		m_arrDoubles.assign(m_arrInts.begin(), m_arrInts.end());
+		std::vector<int64>().swap(m_arrInts);
+		m_type = realValue;
+	}
+	if (m_type != realValue || hasValue(nRow))
+	{
+		return false;
+	}
+	fill(nRow + 1);
+	m_arrDoubles[nRow] = fValue;
+	setValid(nRow);
+	return true;
+}
+
+bool SerializedColumn::setString(int32 nRow, const char* pData, int32 nLength)
+{
+	if (m_type == nullValue)
+	{
+		m_type = stringValue;
+	}
+	if (m_type != stringValue || hasValue(nRow))
+	{
+		return false;
+	}
+	// еƫнʱ
+	fill(nRow);
+	m_strBytes.append(pData, nLength);
+	setValid(nRow);
+	return true;
+}
+
+// ֶͬ(ȥɼԺͬ)ֻȡһ
+bool SerializedColumn::hasValue(int32 nRow) const
+{
+	return size_t(nRow >> 3) < m_arrValidity.size() && isValid(nRow);
+}
+
+void SerializedColumn::setValid(int32 nRow)
+{
+	if (size_t(nRow >> 3) >= m_arrValidity.size())
+	{
+		m_arrValidity.resize((nRow >> 3) + 1);
+	}
+	m_arrValidity[nRow >> 3] |= uint8(1 << (nRow & 7));
+}
+
+//////////////////////////////////////////////////////////////////////////
+SerializedPhpColumns::SerializedPhpColumns()
+	: m_nDeclared(0)
+	, m_nRows(0)
+{
+}
+
+void SerializedPhpColumns::addColumn(const String& strName, SerializedValueType type)
+{
+	assert(type == nullValue || type == intValue || type == realValue || type == stringValue || type == booleanValue);
+	m_arrColumns.insert(m_arrColumns.begin() + m_nDeclared, SerializedColumn(strName, type));
+	m_nDeclared++;
+}
+
+const SerializedColumn* SerializedPhpColumns::find(const String& strName) const
+{
+	for (size_t i = 0; i < m_arrColumns.size(); i++)
+	{
+		if (m_arrColumns[i].name() == strName)
+		{
+			return &m_arrColumns[i];
+		}
+	}
+	return 0;
+}
+
+bool SerializedPhpColumns::parse(const String& strInput)
+{
+	return parse(strInput.data(), int32(strInput.length()));
+}
+
+bool SerializedPhpColumns::parse(const char* pData, int32 nLength)
+{
+	m_arrColumns.resize(m_nDeclared, SerializedColumn(String()));
+	for (size_t i = 0; i < m_arrColumns.size(); i++)
+	{
+		m_arrColumns[i].clear();
+	}
+	m_nRows = 0;
+
+	SerializedPhpScanner scanner(pData, pData + nLength);
+	char chType = 0;
+	int32 nCount = 0;
+	if (!scanner.readType(chType) || chType != 'a' || !scanner.readArrayBegin(nCount))
+	{
+		return false;
+	}
+	// Ա, ʣֽɵض, ÿ4ֽ
+	int32 nReserve = nCount < scanner.remaining() / 4 ? nCount : scanner.remaining() / 4;
+	for (size_t i = 0; i < m_arrColumns.size(); i++)
+	{
+		m_arrColumns[i].reserve(nReserve);
+	}
+
+	bool bResult = true;
+	for (int32 i = 0; i < nCount && bResult; i++)
+	{
+		// еļ, аֵ˳
+		size_t nColumns = m_arrColumns.size();
+		bResult = scanner.skipValue() && readRow(scanner);
+		if (bResult)
+		{
+			m_nRows++;
+		}
+		else
+		{
+			// в: ȥһ½, ˻صһ֮ǰ
+			m_arrColumns.erase(m_arrColumns.begin() + nColumns, m_arrColumns.end());
+			for (size_t j = 0; j < m_arrColumns.size(); j++)
+			{
+				m_arrColumns[j].truncate(m_nRows);
+			}
+		}
+		for (size_t j = 0; j < m_arrColumns.size(); j++)
+		{
+			m_arrColumns[j].fill(m_nRows);
+		}
+	}
+	return bResult && scanner.readEnd() && scanner.eof();
+}
+
+int32 SerializedPhpColumns::findColumn(const char* pName, int32 nLength, size_t& nHint)
+{
+	// еֶ˳ͨͬ, һֶεһ
+	size_t nCount = m_arrColumns.size();
+	for (size_t i = 0; i < nCount; i++)
+	{
+		size_t nIndex = (nHint + i) % nCount;
+		const String& strName = m_arrColumns[nIndex].name();
+		if (strName.length() == size_t(nLength) && memcmp(strName.data(), pName, nLength) == 0)
+		{
+			nHint = nIndex + 1;
+			return int32(nIndex);
+		}
+	}
+	if (m_nDeclared > 0)
+	{
+		return -1;
+	}
+	// ³ֵֶ, ֮ǰоЧ
+	m_arrColumns.push_back(SerializedColumn(String(pName, nLength)));
+	m_arrColumns.back().fill(m_nRows);
+	nHint = nCount + 1;
+	return int32(nCount);
+}
+
+bool SerializedPhpColumns::readRow(SerializedPhpScanner& scanner)
+{
+	SerializedPhpScanner saved = scanner;
+	char chType = 0;
+	int32 nCount = 0;
+	const char* pClassName = 0;
+	int32 nClassNameLength = 0;
+	if (!scanner.readType(chType))
+	{
+		return false;
+	}
+	bool bProperty = chType == 'O';
+	if (chType == 'a')
+	{
+		if (!scanner.readArrayBegin(nCount))
+			return false;
+	}
+	else if (bProperty)
+	{
+		if (!scanner.readObjectBegin(pClassName, nClassNameLength, nCount))
+			return false;
+	}
+	else
+	{
+		// Ǽ¼ֶЧ
+		scanner = saved;
+		return scanner.skipValue();
+	}
+
+	size_t nHint = 0;
+	char szIndex[24];
+	for (int32 i = 0; i < nCount; i++)
+	{
+		const char* pName = 0;
+		int32 nLength = 0;
+		int64 nKey = 0;
+		if (!scanner.readType(chType))
+		{
+			return false;
+		}
+		if (chType == 'i')
+		{
+			if (!scanner.readInteger(nKey, ';'))
+				return false;
+			nLength = snprintf(szIndex, sizeof(szIndex), "%lld", (long long)nKey);
+			pName = szIndex;
+		}
+		else if (chType == 's')
+		{
+			if (!scanner.readString(pName, nLength))
+				return false;
+		}
+		else if (chType == 'S')
+		{
+			if (!scanner.readEscapedString(&m_strBuffer))
+				return false;
+			pName = m_strBuffer.data();
+			nLength = int32(m_strBuffer.length());
+		}
+		else
+		{
+			return false;
+		}
+
+		// "\0*\0prop" / "\0Class\0prop" ƥ
+		if (bProperty && nLength > 0 && pName[0] == '\0')
+		{
+			const char* pScopeEnd = static_cast<const char*>(memchr(pName + 1, '\0', nLength - 1));
+			if (pScopeEnd)
+			{
+				nLength -= int32(pScopeEnd + 1 - pName);
+				pName = pScopeEnd + 1;
+			}
+		}
+
+		int32 nColumn = findColumn(pName, nLength, nHint);
+		if (nColumn < 0)
+		{
+			if (!scanner.skipValue())
+				return false;
+			continue;
+		}
+		if (!readField(scanner, m_arrColumns[nColumn]))
+		{
+			return false;
+		}
+	}
+	return scanner.readEnd();
+}
+
+bool SerializedPhpColumns::readField(SerializedPhpScanner& scanner, SerializedColumn& column)
+{
+	SerializedPhpScanner saved = scanner;
+	char chType = 0;
+	if (!scanner.readType(chType))
+	{
+		return false;
+	}
+	int64 nValue = 0;
+	double fValue = 0;
+	const char* pData = 0;
+	int32 nLength = 0;
+	switch (chType)
+	{
+	case 'N':
+		return true;
+	case 'i':
+		if (!scanner.readInteger(nValue, ';'))
+			return false;
+		column.setInt(m_nRows, nValue, intValue);
+		return true;
+	case 'b':
+		if (!scanner.readInteger(nValue, ';'))
+			return false;
+		column.setInt(m_nRows, nValue != 0, booleanValue);
+		return true;
+	case 'd':
+		if (!scanner.readDouble(fValue))
+			return false;
+		column.setDouble(m_nRows, fValue);
+		return true;
+	case 's':
+		if (!scanner.readString(pData, nLength))
+			return false;
+		column.setString(m_nRows, pData, nLength);
+		return true;
+	case 'S':
+		if (!scanner.readEscapedString(&m_strBuffer))
+			return false;
+		column.setString(m_nRows, m_strBuffer.data(), int32(m_strBuffer.length()));
+		return true;
+	default:
+		// Ƕ׵ֵõȲܷŽ, ΪЧ
+		scanner = saved;
+		return scanner.skipValue();
+	}
+}
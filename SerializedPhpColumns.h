@@ -0,0 +1,112 @@
+/**********************************************************************
+* Copyright (C) 2018 - tx7do - All Rights Reserved
+*
+* ļ:		SerializedPhpColumns.h
+* ժ    Ҫ:		ѽṹͬļ¼鰴н
+*
+*     :		yanglinbo,
+*     :		鿴ļ·.
+*
+***********************************************************************/
+
+#ifndef __SerializedPhpColumns_H__
+#define __SerializedPhpColumns_H__
+
+#include "SerializedPhpParser.h"
+
+
+//////////////////////////////////////////////////////////////////////////
+/// һ
+/// ÿһ, ʹ, ֱľۺ:
+/// - intValue/booleanValue: ints(), ֵΪ0/1
+/// - realValue: doubles()
+/// - stringValue: rowΪbytes()е[offsets()[row], offsets()[row + 1])
+/// validity()ΪЧλͼ, rowжӦrow / 8ֽڵĵrow % 8λ(λǰ);
+/// ֶȱʧΪN;ΪǶ׵/ͲЧ, ӦΪ0մ.
+//////////////////////////////////////////////////////////////////////////
+class SerializedColumn
+{
+public:
+	explicit SerializedColumn(const String& strName, SerializedValueType type = nullValue);
+
+public:
+	const String& name() const { return m_strName; }
+
+	/// δûЧֵʱΪnullValue, ʱû
+	SerializedValueType type() const { return m_type; }
+
+	bool isValid(int32 nRow) const { return (m_arrValidity[nRow >> 3] >> (nRow & 7)) & 1; }
+
+	const uint8* validity() const { return m_arrValidity.empty() ? 0 : &m_arrValidity[0]; }
+	const int64* ints() const { return m_arrInts.empty() ? 0 : &m_arrInts[0]; }
+	const double* doubles() const { return m_arrDoubles.empty() ? 0 : &m_arrDoubles[0]; }
+	const uint32* offsets() const { return m_arrOffsets.empty() ? 0 : &m_arrOffsets[0]; }
+	const char* bytes() const { return m_strBytes.data(); }
+
+private:
+	friend class SerializedPhpColumns;
+
+	void reserve(int32 nRows);
+	void clear();
+	/// 뵽nRows, ²Ч
+	void fill(int32 nRows);
+	/// ضϵnRows, ֮дֵЧλ
+	void truncate(int32 nRows);
+
+	bool setInt(int32 nRow, int64 nValue, SerializedValueType type);
+	bool setDouble(int32 nRow, double fValue);
+	bool setString(int32 nRow, const char* pData, int32 nLength);
+	bool hasValue(int32 nRow) const;
+	void setValid(int32 nRow);
+
+private:
+	String					m_strName;
+	SerializedValueType		m_type;
+	bool					m_bFixedType;	///< ʱָ
+	std::vector<uint8>		m_arrValidity;
+	std::vector<int64>		m_arrInts;
+	std::vector<double>		m_arrDoubles;
+	std::vector<uint32>		m_arrOffsets;
+	String					m_strBytes;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// н
+/// Ϊa:N:{...}, ÿԱһ(, ȥɼǰ׺ƥ).
+/// ֱлֽɨ, ΪйSerializedValue.
+/// addColumnʱֻȡЩֶ, ֶ; δʱֵֶԶ,
+/// еɵһЧֵ, ָ֮ʱΪ(Ϊг).
+/// ɴ븡, ͲֵΪЧ.
+//////////////////////////////////////////////////////////////////////////
+class SerializedPhpColumns
+{
+public:
+	SerializedPhpColumns();
+
+public:
+	/// ΪnullValueʱݾ
+	void addColumn(const String& strName, SerializedValueType type = nullValue);
+
+	/// ʽʱfalse, ѽб, в. ÿνǰϴε, б
+	bool parse(const char* pData, int32 nLength);
+	bool parse(const String& strInput);
+
+	int32 rows() const { return m_nRows; }
+	int32 columns() const { return int32(m_arrColumns.size()); }
+	const SerializedColumn& column(int32 nIndex) const { return m_arrColumns[nIndex]; }
+	const SerializedColumn* find(const String& strName) const;
+
+private:
+	int32 findColumn(const char* pName, int32 nLength, size_t& nHint);
+	bool readRow(SerializedPhpScanner& scanner);
+	bool readField(SerializedPhpScanner& scanner, SerializedColumn& column);
+
+private:
+	std::vector<SerializedColumn> m_arrColumns;
+	size_t		m_nDeclared;		///< ǰm_nDeclaredΪaddColumn
+	int32		m_nRows;
+	String		m_strBuffer;
+};
+
+
+#endif
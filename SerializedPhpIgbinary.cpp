@@ -0,0 +1,673 @@
+/**********************************************************************
+* Copyright (C) 2018 - tx7do - All Rights Reserved
+*
+* ļ:		SerializedPhpIgbinary.cpp
+* ժ    Ҫ:		igbinaryлʽĶд
+*
+*     :		yanglinbo,
+*     :		鿴ļ·.
+*
+***********************************************************************/
+
+#include "SerializedPhpIgbinary.h"
+
+#include <unordered_map>
+
+
+/// igbinaryֽ
+enum SerializedIgbinaryType
+{
+	igbinaryNull			= 0x00,
+	igbinaryRef8			= 0x01,		///< ñ
+	igbinaryRef16			= 0x02,
+	igbinaryRef32			= 0x03,
+	igbinaryFalse			= 0x04,
+	igbinaryTrue			= 0x05,
+	igbinaryLong8p			= 0x06,		///< : ;, Ϊֵ
+	igbinaryLong8n			= 0x07,
+	igbinaryLong16p			= 0x08,
+	igbinaryLong16n			= 0x09,
+	igbinaryLong32p			= 0x0a,
+	igbinaryLong32n			= 0x0b,
+	igbinaryDouble			= 0x0c,
+	igbinaryStringEmpty		= 0x0d,
+	igbinaryStringId8		= 0x0e,		///< ַ
+	igbinaryStringId16		= 0x0f,
+	igbinaryStringId32		= 0x10,
+	igbinaryString8			= 0x11,		///<  + ֽ, Ǽǵַ
+	igbinaryString16		= 0x12,
+	igbinaryString32		= 0x13,
+	igbinaryArray8			= 0x14,		///< Ա + ֵ
+	igbinaryArray16			= 0x15,
+	igbinaryArray32			= 0x16,
+	igbinaryObject8			= 0x17,		///<  + Ա()غ(ObjectSer)
+	igbinaryObject16		= 0x18,
+	igbinaryObject32		= 0x19,
+	igbinaryObjectId8		= 0x1a,		///< Ϊַ
+	igbinaryObjectId16		= 0x1b,
+	igbinaryObjectId32		= 0x1c,
+	igbinaryObjectSer8		= 0x1d,		///< Serializableغ, ıʽC:
+	igbinaryObjectSer16		= 0x1e,
+	igbinaryObjectSer32		= 0x1f,
+	igbinaryLong64p			= 0x20,
+	igbinaryLong64n			= 0x21,
+	igbinaryObjRef8			= 0x22,		///< ͬһ, ñ
+	igbinaryObjRef16		= 0x23,
+	igbinaryObjRef32		= 0x24,
+	igbinaryRef				= 0x25		///< ֵPHP(&), Ǽǵñ
+};
+
+static const int32 kIgbinaryHeaderLength = 4;
+static const int32 kIgbinaryMaxDepth = 4096;
+
+// 8/16/32λֿȵͰ˳, ؿȵֽ
+static inline int32 sizedWidth(uint8 chType, uint8 chType8)
+{
+	return 1 << (chType - chType8);
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// 
+//////////////////////////////////////////////////////////////////////////
+class SerializedIgbinaryReader
+{
+public:
+	SerializedIgbinaryReader(const uint8* pBegin, const uint8* pEnd, SerializedInternTable* pTable)
+		: m_pCurrent(pBegin)
+		, m_pEnd(pEnd)
+		, m_pInternTable(pTable)
+		, m_nDepth(0)
+	{
+	}
+
+public:
+	bool read(SerializedValue& value);
+
+private:
+	/// ַһ, ָֽ; Ϊֵõʱvalue
+	struct StringEntry
+	{
+		const char* pData;
+		uint32 nLength;
+		SerializedValue value;
+	};
+
+	bool readUInt(int32 nWidth, uint64& nValue);
+	bool readValue(SerializedValue& value);
+	bool readString(uint8 chType, size_t& nEntry);
+	bool readStringValue(uint8 chType, SerializedValue& value);
+	bool readMembers(SerializedValue& container, bool bProperty);
+	bool readKey(bool bProperty, SerializedKey& key);
+	bool readObject(uint8 chType, SerializedValue& value);
+
+	SerializedKey makeKey(const char* pName, int32 nLength, bool bProperty);
+	SerializedClassName internClassName(const char* pName, int32 nLength);
+
+private:
+	const uint8* m_pCurrent;
+	const uint8* m_pEnd;
+	SerializedInternTable* m_pInternTable;
+	int32 m_nDepth;
+	std::vector<StringEntry> m_arrStrings;
+	SerializedValueArray m_arrRef;
+	std::vector<SerializedClassName> m_arrClassNames;
+};
+
+bool SerializedIgbinaryReader::read(SerializedValue& value)
+{
+	m_pCurrent += kIgbinaryHeaderLength;
+	return readValue(value) && m_pCurrent == m_pEnd;
+}
+
+bool SerializedIgbinaryReader::readUInt(int32 nWidth, uint64& nValue)
+{
+	if (m_pEnd - m_pCurrent < nWidth)
+	{
+		return false;
+	}
+	nValue = 0;
+	for (int32 i = 0; i < nWidth; i++)
+	{
+		nValue = (nValue << 8) | m_pCurrent[i];
+	}
+	m_pCurrent += nWidth;
+	return true;
+}
+
+bool SerializedIgbinaryReader::readValue(SerializedValue& value)
+{
+	if (m_pCurrent >= m_pEnd)
+	{
+		return false;
+	}
+	uint8 chType = *m_pCurrent++;
+	uint64 nValue = 0;
+	switch (chType)
+	{
+	case igbinaryNull:
+		value = SerializedValue();
+		return true;
+	case igbinaryFalse:
+	case igbinaryTrue:
+		value = SerializedValue(chType == igbinaryTrue);
+		return true;
+	case igbinaryLong8p:
+	case igbinaryLong8n:
+	case igbinaryLong16p:
+	case igbinaryLong16n:
+	case igbinaryLong32p:
+	case igbinaryLong32n:
+	{
+		bool bNegative = (chType - igbinaryLong8p) % 2 != 0;
+		if (!readUInt(1 << ((chType - igbinaryLong8p) / 2), nValue))
+			return false;
+		value = SerializedValue(bNegative ? -int64(nValue) : int64(nValue));
+		return true;
+	}
+	case igbinaryLong64p:
+	case igbinaryLong64n:
+		if (!readUInt(8, nValue))
+			return false;
+		value = SerializedValue(chType == igbinaryLong64p ? int64(nValue) : int64(0 - nValue));
+		return true;
+	case igbinaryDouble:
+	{
+		if (!readUInt(8, nValue))
+			return false;
+		double fValue = 0;
+		memcpy(&fValue, &nValue, sizeof(fValue));
+		value = SerializedValue(fValue);
+		return true;
+	}
+	case igbinaryStringEmpty:
+	case igbinaryStringId8:
+	case igbinaryStringId16:
+	case igbinaryStringId32:
+	case igbinaryString8:
+	case igbinaryString16:
+	case igbinaryString32:
+		return readStringValue(chType, value);
+	case igbinaryArray8:
+	case igbinaryArray16:
+	case igbinaryArray32:
+	{
+		// ռñλ, ٵǼ, ıʽR:/r:ȡͬһ
+		m_pCurrent--;
+		value = SerializedValue(arrayValue);
+		size_t nRefSlot = m_arrRef.size();
+		m_arrRef.push_back(value);
+		if (!readMembers(value, false))
+			return false;
+		m_arrRef[nRefSlot] = value;
+		return true;
+	}
+	case igbinaryObject8:
+	case igbinaryObject16:
+	case igbinaryObject32:
+	case igbinaryObjectId8:
+	case igbinaryObjectId16:
+	case igbinaryObjectId32:
+		return readObject(chType, value);
+	case igbinaryRef8:
+	case igbinaryRef16:
+	case igbinaryRef32:
+	case igbinaryObjRef8:
+	case igbinaryObjRef16:
+	case igbinaryObjRef32:
+	{
+		uint8 chType8 = chType < igbinaryObjRef8 ? igbinaryRef8 : igbinaryObjRef8;
+		if (!readUInt(sizedWidth(chType, chType8), nValue) || nValue >= m_arrRef.size())
+			return false;
+		value = m_arrRef[size_t(nValue)];
+		return true;
+	}
+	case igbinaryRef:
+	{
+		// ͶԼǼ, ֵڴ˵Ǽ
+		if (m_pCurrent >= m_pEnd)
+			return false;
+		uint8 chNext = *m_pCurrent;
+		if (!readValue(value))
+			return false;
+		if (chNext < igbinaryArray8 || chNext > igbinaryObjectId32)
+		{
+			m_arrRef.push_back(value);
+		}
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+bool SerializedIgbinaryReader::readString(uint8 chType, size_t& nEntry)
+{
+	uint64 nValue = 0;
+	if (chType >= igbinaryStringId8 && chType <= igbinaryStringId32)
+	{
+		if (!readUInt(sizedWidth(chType, igbinaryStringId8), nValue) || nValue >= m_arrStrings.size())
+			return false;
+		nEntry = size_t(nValue);
+		return true;
+	}
+	if (chType < igbinaryString8 || chType > igbinaryString32)
+	{
+		return false;
+	}
+	if (!readUInt(sizedWidth(chType, igbinaryString8), nValue) || nValue > uint64(m_pEnd - m_pCurrent))
+	{
+		return false;
+	}
+	StringEntry entry;
+	entry.pData = reinterpret_cast<const char*>(m_pCurrent);
+	entry.nLength = uint32(nValue);
+	m_pCurrent += nValue;
+	nEntry = m_arrStrings.size();
+	m_arrStrings.push_back(entry);
+	return true;
+}
+
+bool SerializedIgbinaryReader::readStringValue(uint8 chType, SerializedValue& value)
+{
+	if (chType == igbinaryStringEmpty)
+	{
+		value = SerializedValue("");
+		return true;
+	}
+	size_t nEntry = 0;
+	if (!readString(chType, nEntry))
+	{
+		return false;
+	}
+	// ͬһŵַֻһ, ֮
+	StringEntry& entry = m_arrStrings[nEntry];
+	if (entry.value.isNull())
+	{
+		if (m_pInternTable)
+		{
+			SerializedStaticString name = m_pInternTable->intern(entry.pData, entry.nLength);
+			entry.value = name.isNull() ? SerializedValue(entry.pData, entry.pData + entry.nLength) : SerializedValue(name);
+		}
+		else
+		{
+			entry.value = SerializedValue(entry.pData, entry.pData + entry.nLength);
+		}
+	}
+	value = entry.value;
+	return true;
+}
+
+bool SerializedIgbinaryReader::readMembers(SerializedValue& container, bool bProperty)
+{
+	if (m_pCurrent >= m_pEnd)
+	{
+		return false;
+	}
+	uint8 chType = *m_pCurrent++;
+	uint64 nCount = 0;
+	if (chType < igbinaryArray8 || chType > igbinaryArray32 || !readUInt(sizedWidth(chType, igbinaryArray8), nCount))
+	{
+		return false;
+	}
+	if (++m_nDepth > kIgbinaryMaxDepth)
+	{
+		return false;
+	}
+	SerializedKey key((int64)0);
+	for (uint64 i = 0; i < nCount; i++)
+	{
+		SerializedValue member;
+		if (!readKey(bProperty, key) || !readValue(member))
+		{
+			return false;
+		}
+		container[key] = member;
+	}
+	m_nDepth--;
+	return true;
+}
+
+bool SerializedIgbinaryReader::readKey(bool bProperty, SerializedKey& key)
+{
+	if (m_pCurrent >= m_pEnd)
+	{
+		return false;
+	}
+	uint8 chType = *m_pCurrent++;
+	uint64 nValue = 0;
+	switch (chType)
+	{
+	case igbinaryLong8p:
+	case igbinaryLong16p:
+	case igbinaryLong32p:
+	case igbinaryLong8n:
+	case igbinaryLong16n:
+	case igbinaryLong32n:
+	{
+		bool bNegative = (chType - igbinaryLong8p) % 2 != 0;
+		if (!readUInt(1 << ((chType - igbinaryLong8p) / 2), nValue))
+			return false;
+		key = SerializedKey(bNegative ? -int64(nValue) : int64(nValue));
+		return true;
+	}
+	case igbinaryLong64p:
+	case igbinaryLong64n:
+		if (!readUInt(8, nValue))
+			return false;
+		key = SerializedKey(chType == igbinaryLong64p ? int64(nValue) : int64(0 - nValue));
+		return true;
+	case igbinaryStringEmpty:
+		key = makeKey("", 0, bProperty);
+		return true;
+	default:
+	{
+		size_t nEntry = 0;
+		if (!readString(chType, nEntry))
+			return false;
+		const StringEntry& entry = m_arrStrings[nEntry];
+		key = makeKey(entry.pData, int32(entry.nLength), bProperty);
+		return true;
+	}
+	}
+}
+
+bool SerializedIgbinaryReader::readObject(uint8 chType, SerializedValue& value)
+{
+	// ַһű
+	size_t nEntry = 0;
+	uint8 chNameType = chType >= igbinaryObjectId8
+		? uint8(chType - igbinaryObjectId8 + igbinaryStringId8)
+		: uint8(chType - igbinaryObject8 + igbinaryString8);
+	if (!readString(chNameType, nEntry))
+	{
+		return false;
+	}
+	SerializedClassName className = internClassName(m_arrStrings[nEntry].pData, int32(m_arrStrings[nEntry].nLength));
+
+	if (m_pCurrent >= m_pEnd)
+	{
+		return false;
+	}
+	uint8 chBody = *m_pCurrent;
+	if (chBody >= igbinaryObjectSer8 && chBody <= igbinaryObjectSer32)
+	{
+		m_pCurrent++;
+		uint64 nLength = 0;
+		if (!readUInt(sizedWidth(chBody, igbinaryObjectSer8), nLength) || nLength > uint64(m_pEnd - m_pCurrent))
+		{
+			return false;
+		}
+		const char* pData = reinterpret_cast<const char*>(m_pCurrent);
+		m_pCurrent += nLength;
+		value = SerializedValue(customValue, pData, pData + nLength, className);
+		m_arrRef.push_back(value);
+		return true;
+	}
+
+	value = SerializedValue(objectValue);
+	value.setClassName(className);
+	size_t nRefSlot = m_arrRef.size();
+	m_arrRef.push_back(value);
+	if (!readMembers(value, true))
+	{
+		return false;
+	}
+	m_arrRef[nRefSlot] = value;
+	return true;
+}
+
+SerializedKey SerializedIgbinaryReader::makeKey(const char* pName, int32 nLength, bool bProperty)
+{
+	// ıʽͬ: "\0*\0prop" Ϊ, "\0Class\0prop" Ϊ˽
+	SerializedVisibility visibility = publicVisibility;
+	SerializedClassName scope;
+	const char* pScopeEnd = bProperty && nLength > 0 && pName[0] == '\0'
+		? static_cast<const char*>(memchr(pName + 1, '\0', nLength - 1))
+		: 0;
+	if (pScopeEnd)
+	{
+		int32 nScopeLength = int32(pScopeEnd - pName - 1);
+		if (nScopeLength == 1 && pName[1] == '*')
+		{
+			visibility = protectedVisibility;
+		}
+		else
+		{
+			visibility = privateVisibility;
+			scope = internClassName(pName + 1, nScopeLength);
+		}
+		nLength -= int32(pScopeEnd + 1 - pName);
+		pName = pScopeEnd + 1;
+	}
+
+	int64 nIndex = 0;
+	if (visibility == publicVisibility && SerializedKey::parseInteger(pName, nLength, nIndex))
+	{
+		return SerializedKey(nIndex);
+	}
+	if (m_pInternTable)
+	{
+		SerializedStaticString name = m_pInternTable->intern(pName, nLength);
+		if (!name.isNull())
+		{
+			return SerializedKey(name, visibility, scope);
+		}
+	}
+	return SerializedKey(pName, nLength, visibility, scope);
+}
+
+SerializedClassName SerializedIgbinaryReader::internClassName(const char* pName, int32 nLength)
+{
+	for (size_t i = 0; i < m_arrClassNames.size(); i++)
+	{
+		const String& strName = *m_arrClassNames[i];
+		if (int32(strName.length()) == nLength && memcmp(strName.data(), pName, nLength) == 0)
+		{
+			return m_arrClassNames[i];
+		}
+	}
+	SerializedClassName className = std::make_shared<const String>(pName, nLength);
+	m_arrClassNames.push_back(className);
+	return className;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// 
+//////////////////////////////////////////////////////////////////////////
+class SerializedIgbinaryWriter
+{
+public:
+	explicit SerializedIgbinaryWriter(String& strOutput)
+		: m_strOutput(strOutput)
+	{
+	}
+
+public:
+	bool write(const SerializedValue& value);
+
+private:
+	void writeUInt(int32 nWidth, uint64 nValue);
+	void writeSized(uint8 chType8, uint64 nValue);
+	void writeInteger(int64 nValue);
+	void writeString(uint8 chString8, uint8 chId8, const char* pData, uint32 nLength);
+	void writeKey(const SerializedKey& key, bool bProperty);
+	bool writeValue(const SerializedValue& value);
+	bool writeMembers(const SerializedValue& container, bool bProperty);
+
+private:
+	String& m_strOutput;
+	std::unordered_map<String, uint32> m_mapStrings;
+};
+
+bool SerializedIgbinaryWriter::write(const SerializedValue& value)
+{
+	static const char szHeader[kIgbinaryHeaderLength] = { 0, 0, 0, 2 };
+	m_strOutput.append(szHeader, kIgbinaryHeaderLength);
+	return writeValue(value);
+}
+
+void SerializedIgbinaryWriter::writeUInt(int32 nWidth, uint64 nValue)
+{
+	char szBuffer[8];
+	for (int32 i = nWidth - 1; i >= 0; i--)
+	{
+		szBuffer[i] = char(nValue & 0xff);
+		nValue >>= 8;
+	}
+	m_strOutput.append(szBuffer, nWidth);
+}
+
+// ֵѡ8/16/32λ̵һ
+void SerializedIgbinaryWriter::writeSized(uint8 chType8, uint64 nValue)
+{
+	int32 nStep = nValue <= 0xff ? 0 : nValue <= 0xffff ? 1 : 2;
+	m_strOutput.push_back(char(chType8 + nStep));
+	writeUInt(1 << nStep, nValue);
+}
+
+void SerializedIgbinaryWriter::writeInteger(int64 nValue)
+{
+	bool bNegative = nValue < 0;
+	uint64 nAbsolute = bNegative ? 0 - uint64(nValue) : uint64(nValue);
+	if (nAbsolute > 0xffffffff)
+	{
+		m_strOutput.push_back(char(bNegative ? igbinaryLong64n : igbinaryLong64p));
+		writeUInt(8, nAbsolute);
+		return;
+	}
+	int32 nStep = nAbsolute <= 0xff ? 0 : nAbsolute <= 0xffff ? 1 : 2;
+	m_strOutput.push_back(char(igbinaryLong8p + nStep * 2 + (bNegative ? 1 : 0)));
+	writeUInt(1 << nStep, nAbsolute);
+}
+
+// һγʱдֽڲǼǱ, ֻ֮д
+void SerializedIgbinaryWriter::writeString(uint8 chString8, uint8 chId8, const char* pData, uint32 nLength)
+{
+	std::pair<std::unordered_map<String, uint32>::iterator, bool> result =
+		m_mapStrings.insert(std::make_pair(String(pData, nLength), uint32(m_mapStrings.size())));
+	if (!result.second)
+	{
+		writeSized(chId8, result.first->second);
+		return;
+	}
+	writeSized(chString8, nLength);
+	m_strOutput.append(pData, nLength);
+}
+
+void SerializedIgbinaryWriter::writeKey(const SerializedKey& key, bool bProperty)
+{
+	if (key.isInt())
+	{
+		writeInteger(key.intValue());
+	}
+	else if (key.nameLength() == 0 && key.visibility() == publicVisibility)
+	{
+		m_strOutput.push_back(char(igbinaryStringEmpty));
+	}
+	else if (bProperty && key.visibility() != publicVisibility)
+	{
+		String strName = key.mangledName();
+		writeString(igbinaryString8, igbinaryStringId8, strName.data(), uint32(strName.length()));
+	}
+	else
+	{
+		writeString(igbinaryString8, igbinaryStringId8, key.name(), key.nameLength());
+	}
+}
+
+bool SerializedIgbinaryWriter::writeValue(const SerializedValue& value)
+{
+	const char* pBegin = 0;
+	const char* pEnd = 0;
+	switch (value.type())
+	{
+	case nullValue:
+	case referenceValue:
+		m_strOutput.push_back(char(igbinaryNull));
+		return true;
+	case booleanValue:
+		m_strOutput.push_back(char(value.asBool() ? igbinaryTrue : igbinaryFalse));
+		return true;
+	case intValue:
+		writeInteger(value.asInt64());
+		return true;
+	case realValue:
+	{
+		double fValue = value.asDouble();
+		uint64 nBits = 0;
+		memcpy(&nBits, &fValue, sizeof(nBits));
+		m_strOutput.push_back(char(igbinaryDouble));
+		writeUInt(8, nBits);
+		return true;
+	}
+	case stringValue:
+		value.getString(&pBegin, &pEnd);
+		if (pBegin == pEnd)
+		{
+			m_strOutput.push_back(char(igbinaryStringEmpty));
+			return true;
+		}
+		writeString(igbinaryString8, igbinaryStringId8, pBegin, uint32(pEnd - pBegin));
+		return true;
+	case arrayValue:
+		return writeMembers(value, false);
+	case objectValue:
+	case customValue:
+	{
+		const char* pClassName = value.className() ? value.className() : "stdClass";
+		const String* pName = value.classNameRef().get();
+		uint32 nClassNameLength = pName ? uint32(pName->length()) : uint32(strlen(pClassName));
+		writeString(igbinaryObject8, igbinaryObjectId8, pClassName, nClassNameLength);
+		if (value.type() == objectValue)
+		{
+			return writeMembers(value, true);
+		}
+		value.getString(&pBegin, &pEnd);
+		writeSized(igbinaryObjectSer8, uint64(pEnd - pBegin));
+		m_strOutput.append(pBegin, pEnd - pBegin);
+		return true;
+	}
+	default:
+		// öigbinaryûжӦ
+		return false;
+	}
+}
+
+bool SerializedIgbinaryWriter::writeMembers(const SerializedValue& container, bool bProperty)
+{
+	writeSized(igbinaryArray8, uint64(container.size()));
+	for (SerializedValue::const_iterator it = container.begin(); it != container.end(); ++it)
+	{
+		writeKey(it.key(), bProperty);
+		if (!writeValue(it.value()))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+bool SerializedPhpIgbinary::isIgbinary(const char* pData, int32 nLength)
+{
+	// 汾12, ıʽ'\0'ͷ
+	return nLength >= kIgbinaryHeaderLength && pData[0] == 0 && pData[1] == 0 && pData[2] == 0
+		&& (pData[3] == 1 || pData[3] == 2);
+}
+
+bool SerializedPhpIgbinary::decode(const char* pData, int32 nLength, SerializedValue& value, SerializedInternTable* pTable)
+{
+	if (!isIgbinary(pData, nLength))
+	{
+		return false;
+	}
+	const uint8* pBegin = reinterpret_cast<const uint8*>(pData);
+	SerializedIgbinaryReader reader(pBegin, pBegin + nLength, pTable);
+	return reader.read(value);
+}
+
+bool SerializedPhpIgbinary::encode(const SerializedValue& value, String& strOutput)
+{
+	SerializedIgbinaryWriter writer(strOutput);
+	return writer.write(value);
+}
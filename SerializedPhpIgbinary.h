@@ -0,0 +1,40 @@
+/**********************************************************************
+* Copyright (C) 2018 - tx7do - All Rights Reserved
+*
+* ļ:		SerializedPhpIgbinary.h
+* ժ    Ҫ:		igbinaryлʽĶд
+*
+*     :		yanglinbo,
+*     :		鿴ļ·.
+*
+***********************************************************************/
+
+#ifndef __SerializedPhpIgbinary_H__
+#define __SerializedPhpIgbinary_H__
+
+#include "SerializedPhpParser.h"
+
+
+//////////////////////////////////////////////////////////////////////////
+/// igbinaryʽ
+/// дSerializedPhpParserͬSerializedValue. 4ֽڴ˰汾(12)ͷ,
+/// SerializedPhpParser::parse()ļͷʱԶigbinary.
+/// ַ: ÿдַ(ֵ)α, ֮ظʱֻд,
+/// ʱͬһŵֵַһ.
+/// ñ: 顢ʹñǵֵα, ıʽR:/r:һȡͬһ.
+//////////////////////////////////////////////////////////////////////////
+class SerializedPhpIgbinary
+{
+public:
+	/// Ƿigbinaryļͷͷ
+	static bool isIgbinary(const char* pData, int32 nLength);
+
+	/// ʽʱfalse, valueΪѽĲ; pTableΪ0ʱΪפ
+	static bool decode(const char* pData, int32 nLength, SerializedValue& value, SerializedInternTable* pTable = 0);
+
+	/// 汾2, ֵֵ֧(ö)false
+	static bool encode(const SerializedValue& value, String& strOutput);
+};
+
+
+#endif
@@ -0,0 +1,1161 @@
+/**********************************************************************
+* Copyright (C) 2018 - tx7do - All Rights Reserved
+*
+* ļ:		SerializedPhpJson.cpp
+* ժ    Ҫ:		PHPлJSONת
+*
+*     :		yanglinbo,
+*     :		鿴ļ·.
+*
+***********************************************************************/
+
+#include "SerializedPhpJson.h"
+
+#include <cfloat>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SERIALIZED_PHP_JSON_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+static inline bool isJsonEscape(unsigned char ch)
+{
+	return ch < 0x20 || ch == '"' || ch == '\\';
+}
+
+static inline uint32 lowestBit(uint32 nMask)
+{
+#if defined(_MSC_VER)
+	unsigned long nIndex = 0;
+	_BitScanForward(&nIndex, nMask);
+	return uint32(nIndex);
+#else
+	return uint32(__builtin_ctz(nMask));
+#endif
+}
+
+// صһҪתַ('"', '\', ַ)λ, ûʱnLength; ֧SSE2ʱÿαȽ16ֽ
+static size_t findJsonEscape(const char* pData, size_t nLength)
+{
+	size_t i = 0;
+#ifdef SERIALIZED_PHP_JSON_SSE2
+	const __m128i quote = _mm_set1_epi8('"');
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i control = _mm_set1_epi8(0x1F);
+	for (; i + 16 <= nLength; i += 16)
+	{
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + i));
+		// max(ch, 0x1F) == 0x1F ޷űȽ ch <= 0x1F
+		__m128i escape = _mm_or_si128(
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+			_mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control));
+		uint32 nMask = uint32(_mm_movemask_epi8(escape));
+		if (nMask)
+		{
+			return i + lowestBit(nMask);
+		}
+	}
+#endif
+	for (; i < nLength; i++)
+	{
+		if (isJsonEscape((unsigned char)pData[i]))
+		{
+			return i;
+		}
+	}
+	return nLength;
+}
+
+static void appendJsonString(String& strOutput, const char* pData, size_t nLength)
+{
+	static const char szHex[] = "0123456789abcdef";
+	strOutput.push_back('"');
+	while (nLength)
+	{
+		// Ҫתֽ׷
+		size_t nRun = findJsonEscape(pData, nLength);
+		strOutput.append(pData, nRun);
+		if (nRun == nLength)
+		{
+			break;
+		}
+		unsigned char ch = (unsigned char)pData[nRun];
+		switch (ch)
+		{
+		case '"':
+			strOutput.append("\\\"", 2);
+			break;
+		case '\\':
+			strOutput.append("\\\\", 2);
+			break;
+		case '\b':
+			strOutput.append("\\b", 2);
+			break;
+		case '\f':
+			strOutput.append("\\f", 2);
+			break;
+		case '\n':
+			strOutput.append("\\n", 2);
+			break;
+		case '\r':
+			strOutput.append("\\r", 2);
+			break;
+		case '\t':
+			strOutput.append("\\t", 2);
+			break;
+		default:
+		{
+			char szEscape[6] = { '\\', 'u', '0', '0', szHex[ch >> 4], szHex[ch & 0x0F] };
+			strOutput.append(szEscape, sizeof(szEscape));
+		}
+		break;
+		}
+		pData += nRun + 1;
+		nLength -= nRun + 1;
+	}
+	strOutput.push_back('"');
+}
+
+static void appendJsonInteger(String& strOutput, int64 nValue)
+{
+	char szBuffer[24];
+	char* pEnd = szBuffer + sizeof(szBuffer);
+	char* p = pEnd;
+	uint64 nMagnitude = nValue < 0 ? 0 - uint64(nValue) : uint64(nValue);
+	do
+	{
+		*--p = char('0' + nMagnitude % 10);
+		nMagnitude /= 10;
+	} while (nMagnitude != 0);
+	if (nValue < 0)
+	{
+		*--p = '-';
+	}
+	strOutput.append(p, pEnd - p);
+}
+
+static void appendJsonDouble(String& strOutput, double fValue)
+{
+	// JSONûNAN/INF
+	if (fValue != fValue || fValue > DBL_MAX || fValue < -DBL_MAX)
+	{
+		strOutput.append("null", 4);
+		return;
+	}
+	char szBuffer[32];
+	int32 nLength = SerializedPhpWriter::formatDouble(fValue, szBuffer, sizeof(szBuffer));
+	strOutput.append(szBuffer, nLength);
+	// json_encodeһ, ֵĸ".0"
+	if (strpbrk(szBuffer, ".e") == 0)
+	{
+		strOutput.append(".0", 2);
+	}
+}
+
+static inline bool isDigit(char ch)
+{
+	return ch >= '0' && ch <= '9';
+}
+
+// PHPd:ֵ("0.1", "1.0E+25")ǺϷJSON, ԭ
+static bool isJsonNumber(const char* p, const char* pEnd)
+{
+	if (p < pEnd && *p == '-')
+	{
+		p++;
+	}
+	if (p == pEnd || !isDigit(*p))
+	{
+		return false;
+	}
+	if (*p == '0')
+	{
+		p++;
+	}
+	else
+	{
+		while (p < pEnd && isDigit(*p))
+			p++;
+	}
+	if (p < pEnd && *p == '.')
+	{
+		const char* pDigits = ++p;
+		while (p < pEnd && isDigit(*p))
+			p++;
+		if (p == pDigits)
+			return false;
+	}
+	if (p < pEnd && (*p == 'e' || *p == 'E'))
+	{
+		p++;
+		if (p < pEnd && (*p == '+' || *p == '-'))
+			p++;
+		const char* pDigits = p;
+		while (p < pEnd && isDigit(*p))
+			p++;
+		if (p == pDigits)
+			return false;
+	}
+	return p == pEnd;
+}
+
+// ȥ"\0*\0""\0Class\0"ɼǰ׺
+static void stripVisibility(const char*& pName, int32& nLength)
+{
+	if (nLength > 0 && pName[0] == '\0')
+	{
+		const char* pScopeEnd = static_cast<const char*>(memchr(pName + 1, '\0', nLength - 1));
+		if (pScopeEnd)
+		{
+			nLength -= int32(pScopeEnd + 1 - pName);
+			pName = pScopeEnd + 1;
+		}
+	}
+}
+
+namespace
+{
+
+//////////////////////////////////////////////////////////////////////////
+/// л -> JSON
+//////////////////////////////////////////////////////////////////////////
+class SerializedJsonEmitter
+{
+public:
+	SerializedJsonEmitter(const char* pBegin, const char* pEnd, String& strOutput)
+		: m_scanner(pBegin, pEnd)
+		, m_strOutput(strOutput)
+		, m_nDepth(0)
+	{
+		// øJSON, Ƕ׵ÿʹָ, ޶Ϊɱ
+		size_t nInput = size_t(pEnd - pBegin);
+		m_nOutputLimit = strOutput.size() + std::max(nInput * kMaxExpansion, size_t(kMinOutputLimit));
+	}
+
+public:
+	bool emit()
+	{
+		return emitValue() && m_scanner.eof();
+	}
+
+private:
+	enum
+	{
+		kMaxExpansion = 64,				///< Ϊı
+		kMinOutputLimit = 1 << 20		///< ܶʱ
+	};
+
+	bool emitValue();
+	bool emitArray(int32 nCount);
+	void rewriteAsObject(size_t nOutputMark, size_t nSlotMark, size_t nMemberMark);
+	bool emitMembers(int32 nCount, bool bProperty);
+	bool emitKey(bool bProperty);
+
+private:
+	SerializedPhpScanner m_scanner;
+	String& m_strOutput;
+	/// PHPı(1ʼ, R:ռ)¼ÿֵJSON, δĽβΪnpos
+	std::vector<std::pair<size_t, size_t> > m_arrSlots;
+	/// беԱֵе, Ƕ׵ѹջ
+	std::vector<size_t> m_arrMembers;
+	String m_strBuffer;
+	int32 m_nDepth;
+	size_t m_nOutputLimit;
+};
+
+bool SerializedJsonEmitter::emitValue()
+{
+	char chType = 0;
+	if (!m_scanner.readType(chType))
+	{
+		return false;
+	}
+	if (chType == 'R' || chType == 'r')
+	{
+		int64 nSlot = 0;
+		if (!m_scanner.readInteger(nSlot, ';'))
+		{
+			return false;
+		}
+		size_t nBegin = m_strOutput.size();
+		if (nSlot >= 1 && nSlot <= int64(m_arrSlots.size()) && m_arrSlots[size_t(nSlot - 1)].second != String::npos)
+		{
+			const std::pair<size_t, size_t>& slot = m_arrSlots[size_t(nSlot - 1)];
+			if (slot.second - slot.first > m_nOutputLimit - m_strOutput.size())
+			{
+				return false;
+			}
+			m_strOutput.append(m_strOutput, slot.first, slot.second - slot.first);
+		}
+		else
+		{
+			// ڵ, JSON޷ʾ
+			m_strOutput.append("null", 4);
+		}
+		if (chType == 'r')
+		{
+			m_arrSlots.push_back(std::make_pair(nBegin, m_strOutput.size()));
+		}
+		return true;
+	}
+
+	size_t nSlot = m_arrSlots.size();
+	m_arrSlots.push_back(std::make_pair(m_strOutput.size(), String::npos));
+
+	bool bResult = false;
+	int64 nInt = 0;
+	double fReal = 0;
+	const char* pData = 0;
+	const char* pClassName = 0;
+	int32 nLength = 0;
+	int32 nCount = 0;
+	switch (chType)
+	{
+	case 'N':
+		m_strOutput.append("null", 4);
+		bResult = true;
+		break;
+	case 'b':
+		bResult = m_scanner.readInteger(nInt, ';');
+		if (nInt)
+			m_strOutput.append("true", 4);
+		else
+			m_strOutput.append("false", 5);
+		break;
+	case 'i':
+		bResult = m_scanner.readInteger(nInt, ';');
+		appendJsonInteger(m_strOutput, nInt);
+		break;
+	case 'd':
+	{
+		const char* pNumber = m_scanner.current();
+		bResult = m_scanner.readDouble(fReal);
+		if (bResult && isJsonNumber(pNumber, m_scanner.current() - 1))
+		{
+			m_strOutput.append(pNumber, m_scanner.current() - 1 - pNumber);
+		}
+		else
+		{
+			appendJsonDouble(m_strOutput, fReal);
+		}
+	}
+	break;
+	case 's':
+		bResult = m_scanner.readString(pData, nLength);
+		if (bResult)
+			appendJsonString(m_strOutput, pData, nLength);
+		break;
+	case 'S':
+		bResult = m_scanner.readEscapedString(&m_strBuffer);
+		if (bResult)
+			appendJsonString(m_strOutput, m_strBuffer.data(), m_strBuffer.length());
+		break;
+	case 'E':
+		// "Class:Case" ֻö
+		bResult = m_scanner.readString(pData, nLength);
+		if (bResult)
+		{
+			const char* pSeparator = static_cast<const char*>(memchr(pData, ':', nLength));
+			const char* pCase = pSeparator ? pSeparator + 1 : pData;
+			appendJsonString(m_strOutput, pCase, pData + nLength - pCase);
+		}
+		break;
+	case 'C':
+		bResult = m_scanner.readCustom(pClassName, nLength, pData, nCount);
+		if (bResult)
+			appendJsonString(m_strOutput, pData, nCount);
+		break;
+	case 'a':
+		m_nDepth++;
+		bResult = m_nDepth <= SerializedPhpScanner::kMaxDepth && m_scanner.readArrayBegin(nCount) && emitArray(nCount);
+		m_nDepth--;
+		break;
+	case 'O':
+		m_nDepth++;
+		bResult = m_nDepth <= SerializedPhpScanner::kMaxDepth && m_scanner.readObjectBegin(pClassName, nLength, nCount);
+		if (bResult)
+		{
+			m_strOutput.push_back('{');
+			bResult = emitMembers(nCount, true) && m_scanner.readEnd();
+			m_strOutput.push_back('}');
+		}
+		m_nDepth--;
+		break;
+	default:
+		break;
+	}
+	if (bResult)
+	{
+		m_arrSlots[nSlot].second = m_strOutput.size();
+	}
+	return bResult;
+}
+
+bool SerializedJsonEmitter::emitArray(int32 nCount)
+{
+	// Ȱб, һ±ļʱĲ־͵ظдΪ, ɨ
+	size_t nOutputMark = m_strOutput.size();
+	size_t nSlotMark = m_arrSlots.size();
+	size_t nMemberMark = m_arrMembers.size();
+	bool bList = true;
+
+	m_strOutput.push_back('[');
+	for (int32 i = 0; i < nCount; i++)
+	{
+		if (i)
+		{
+			m_strOutput.push_back(',');
+		}
+		if (bList)
+		{
+			SerializedPhpScanner key = m_scanner;
+			char chType = 0;
+			int64 nKey = -1;
+			const char* pData = 0;
+			int32 nLength = 0;
+			if (!key.readType(chType))
+			{
+				return false;
+			}
+			if (chType == 'i')
+			{
+				key.readInteger(nKey, ';');
+			}
+			else if (chType == 's' && key.readString(pData, nLength))
+			{
+				SerializedKey::parseInteger(pData, nLength, nKey);
+			}
+			if (nKey == i)
+			{
+				m_scanner = key;
+				m_arrMembers.push_back(m_strOutput.size());
+				if (!emitValue())
+				{
+					return false;
+				}
+				continue;
+			}
+			rewriteAsObject(nOutputMark, nSlotMark, nMemberMark);
+			bList = false;
+		}
+		if (!emitKey(false))
+		{
+			return false;
+		}
+		m_strOutput.push_back(':');
+		if (!emitValue())
+		{
+			return false;
+		}
+	}
+	m_arrMembers.resize(nMemberMark);
+	m_strOutput.push_back(bList ? ']' : '}');
+	return m_scanner.readEnd();
+}
+
+void SerializedJsonEmitter::rewriteAsObject(size_t nOutputMark, size_t nSlotMark, size_t nMemberMark)
+{
+	// Ϊ"[v0,v1,...,"(гԱʱ','β), Ϊ"{"0":v0,"1":v1,...,"
+	size_t nMembers = m_arrMembers.size() - nMemberMark;
+	String strObject;
+	strObject.reserve(m_strOutput.size() - nOutputMark + nMembers * 8);
+	strObject.push_back('{');
+	// ÿԱǰֽۼ, ƽм¼
+	std::vector<size_t> arrShift(nMembers);
+	for (size_t k = 0; k < nMembers; k++)
+	{
+		size_t nBegin = m_arrMembers[nMemberMark + k];
+		size_t nEnd = k + 1 < nMembers ? m_arrMembers[nMemberMark + k + 1] : m_strOutput.size();
+		size_t nKeyBegin = strObject.size();
+		strObject.push_back('"');
+		appendJsonInteger(strObject, int64(k));
+		strObject.append("\":", 2);
+		arrShift[k] = (k ? arrShift[k - 1] : 0) + strObject.size() - nKeyBegin;
+		strObject.append(m_strOutput, nBegin, nEnd - nBegin);
+	}
+	// ֮¼ֵĳԱ, 
+	size_t k = 0;
+	for (size_t j = nSlotMark; j < m_arrSlots.size(); j++)
+	{
+		std::pair<size_t, size_t>& slot = m_arrSlots[j];
+		while (k + 1 < nMembers && m_arrMembers[nMemberMark + k + 1] <= slot.first)
+		{
+			k++;
+		}
+		slot.first += arrShift[k];
+		slot.second += arrShift[k];
+	}
+	m_strOutput.replace(nOutputMark, String::npos, strObject);
+	m_arrMembers.resize(nMemberMark);
+}
+
+bool SerializedJsonEmitter::emitMembers(int32 nCount, bool bProperty)
+{
+	for (int32 i = 0; i < nCount; i++)
+	{
+		if (i)
+		{
+			m_strOutput.push_back(',');
+		}
+		if (!emitKey(bProperty))
+		{
+			return false;
+		}
+		m_strOutput.push_back(':');
+		if (!emitValue())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool SerializedJsonEmitter::emitKey(bool bProperty)
+{
+	char chType = 0;
+	if (!m_scanner.readType(chType))
+	{
+		return false;
+	}
+	const char* pName = 0;
+	int32 nLength = 0;
+	switch (chType)
+	{
+	case 'i':
+	{
+		int64 nKey = 0;
+		if (!m_scanner.readInteger(nKey, ';'))
+		{
+			return false;
+		}
+		m_strOutput.push_back('"');
+		appendJsonInteger(m_strOutput, nKey);
+		m_strOutput.push_back('"');
+		return true;
+	}
+	case 's':
+		if (!m_scanner.readString(pName, nLength))
+		{
+			return false;
+		}
+		break;
+	case 'S':
+		if (!m_scanner.readEscapedString(&m_strBuffer))
+		{
+			return false;
+		}
+		pName = m_strBuffer.data();
+		nLength = int32(m_strBuffer.length());
+		break;
+	default:
+		return false;
+	}
+	if (bProperty)
+	{
+		stripVisibility(pName, nLength);
+	}
+	appendJsonString(m_strOutput, pName, nLength);
+	return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// JSON -> л
+/// лʽҪдĳԱ, ˷: һУ鲢˳
+/// ÿ/ĳԱ, ڶ.
+//////////////////////////////////////////////////////////////////////////
+class SerializedJsonReader
+{
+public:
+	SerializedJsonReader(const char* pBegin, const char* pEnd, String& strOutput)
+		: m_pBegin(pBegin)
+		, m_pCurrent(pBegin)
+		, m_pEnd(pEnd)
+		, m_writer(strOutput)
+		, m_bCounting(false)
+		, m_nNextCount(0)
+		, m_nDepth(0)
+	{
+	}
+
+public:
+	bool read();
+
+private:
+	void skipSpace();
+	bool readValue();
+	bool readArray();
+	bool readObject();
+	bool readString(String* pValue);
+	bool readHex(uint32& nCode);
+	bool readNumber();
+	bool readLiteral(const char* szLiteral, int32 nLength);
+
+private:
+	const char*	m_pBegin;
+	const char*	m_pCurrent;
+	const char*	m_pEnd;
+	SerializedPhpWriter m_writer;
+	bool m_bCounting;
+	std::vector<int32> m_arrCounts;
+	size_t m_nNextCount;
+	String m_strBuffer;
+	int32 m_nDepth;
+};
+
+bool SerializedJsonReader::read()
+{
+	m_bCounting = true;
+	m_pCurrent = m_pBegin;
+	if (!readValue())
+	{
+		return false;
+	}
+	skipSpace();
+	if (m_pCurrent != m_pEnd)
+	{
+		return false;
+	}
+
+	m_bCounting = false;
+	m_pCurrent = m_pBegin;
+	m_nNextCount = 0;
+	return readValue();
+}
+
+void SerializedJsonReader::skipSpace()
+{
+	while (m_pCurrent < m_pEnd && (*m_pCurrent == ' ' || *m_pCurrent == '\t' || *m_pCurrent == '\n' || *m_pCurrent == '\r'))
+	{
+		++m_pCurrent;
+	}
+}
+
+bool SerializedJsonReader::readValue()
+{
+	skipSpace();
+	if (m_pCurrent >= m_pEnd)
+	{
+		return false;
+	}
+	bool bResult = false;
+	switch (*m_pCurrent)
+	{
+	case '{':
+	case '[':
+		// Ƕײ뷴лʱͬ
+		if (++m_nDepth > SerializedPhpScanner::kMaxDepth)
+		{
+			return false;
+		}
+		bResult = *m_pCurrent == '{' ? readObject() : readArray();
+		m_nDepth--;
+		return bResult;
+	case '"':
+		if (!readString(m_bCounting ? 0 : &m_strBuffer))
+		{
+			return false;
+		}
+		if (!m_bCounting)
+		{
+			m_writer.writeString(m_strBuffer.data(), int32(m_strBuffer.length()));
+		}
+		return true;
+	case 't':
+		if (!readLiteral("true", 4))
+		{
+			return false;
+		}
+		if (!m_bCounting)
+		{
+			m_writer.writeBool(true);
+		}
+		return true;
+	case 'f':
+		if (!readLiteral("false", 5))
+		{
+			return false;
+		}
+		if (!m_bCounting)
+		{
+			m_writer.writeBool(false);
+		}
+		return true;
+	case 'n':
+		if (!readLiteral("null", 4))
+		{
+			return false;
+		}
+		if (!m_bCounting)
+		{
+			m_writer.writeNull();
+		}
+		return true;
+	default:
+		return readNumber();
+	}
+}
+
+bool SerializedJsonReader::readArray()
+{
+	++m_pCurrent;
+	size_t nCountSlot = m_arrCounts.size();
+	if (m_bCounting)
+	{
+		m_arrCounts.push_back(0);
+	}
+	else
+	{
+		m_writer.writeArrayBegin(m_arrCounts[m_nNextCount++]);
+	}
+
+	skipSpace();
+	if (m_pCurrent < m_pEnd && *m_pCurrent == ']')
+	{
+		++m_pCurrent;
+	}
+	else
+	{
+		for (int32 i = 0; ; i++)
+		{
+			if (m_bCounting)
+			{
+				m_arrCounts[nCountSlot]++;
+			}
+			else
+			{
+				m_writer.writeInt(i);
+			}
+			if (!readValue())
+			{
+				return false;
+			}
+			skipSpace();
+			if (m_pCurrent >= m_pEnd)
+			{
+				return false;
+			}
+			char ch = *m_pCurrent++;
+			if (ch == ']')
+			{
+				break;
+			}
+			if (ch != ',')
+			{
+				return false;
+			}
+		}
+	}
+
+	if (!m_bCounting)
+	{
+		m_writer.writeEnd();
+	}
+	return true;
+}
+
+bool SerializedJsonReader::readObject()
+{
+	++m_pCurrent;
+	size_t nCountSlot = m_arrCounts.size();
+	if (m_bCounting)
+	{
+		m_arrCounts.push_back(0);
+	}
+	else
+	{
+		m_writer.writeArrayBegin(m_arrCounts[m_nNextCount++]);
+	}
+
+	skipSpace();
+	if (m_pCurrent < m_pEnd && *m_pCurrent == '}')
+	{
+		++m_pCurrent;
+	}
+	else
+	{
+		for (;;)
+		{
+			skipSpace();
+			if (m_pCurrent >= m_pEnd || *m_pCurrent != '"' || !readString(m_bCounting ? 0 : &m_strBuffer))
+			{
+				return false;
+			}
+			if (m_bCounting)
+			{
+				m_arrCounts[nCountSlot]++;
+			}
+			else
+			{
+				// PHPһ, 淶Ϊ
+				int64 nKey = 0;
+				if (SerializedKey::parseInteger(m_strBuffer.data(), uint32(m_strBuffer.length()), nKey))
+				{
+					m_writer.writeInt(nKey);
+				}
+				else
+				{
+					m_writer.writeString(m_strBuffer.data(), int32(m_strBuffer.length()));
+				}
+			}
+			skipSpace();
+			if (m_pCurrent >= m_pEnd || *m_pCurrent++ != ':')
+			{
+				return false;
+			}
+			if (!readValue())
+			{
+				return false;
+			}
+			skipSpace();
+			if (m_pCurrent >= m_pEnd)
+			{
+				return false;
+			}
+			char ch = *m_pCurrent++;
+			if (ch == '}')
+			{
+				break;
+			}
+			if (ch != ',')
+			{
+				return false;
+			}
+		}
+	}
+
+	if (!m_bCounting)
+	{
+		m_writer.writeEnd();
+	}
+	return true;
+}
+
+bool SerializedJsonReader::readHex(uint32& nCode)
+{
+	if (m_pEnd - m_pCurrent < 4)
+	{
+		return false;
+	}
+	nCode = 0;
+	for (int i = 0; i < 4; i++)
+	{
+		char chHex = *m_pCurrent++;
+		int nDigit = chHex >= '0' && chHex <= '9' ? chHex - '0'
+			: chHex >= 'a' && chHex <= 'f' ? chHex - 'a' + 10
+			: chHex >= 'A' && chHex <= 'F' ? chHex - 'A' + 10
+			: -1;
+		if (nDigit < 0)
+		{
+			return false;
+		}
+		nCode = nCode * 16 + uint32(nDigit);
+	}
+	return true;
+}
+
+bool SerializedJsonReader::readString(String* pValue)
+{
+	++m_pCurrent;
+	if (pValue)
+	{
+		pValue->clear();
+	}
+	for (;;)
+	{
+		size_t nRun = findJsonEscape(m_pCurrent, m_pEnd - m_pCurrent);
+		if (pValue)
+		{
+			pValue->append(m_pCurrent, nRun);
+		}
+		m_pCurrent += nRun;
+		if (m_pCurrent >= m_pEnd)
+		{
+			return false;
+		}
+		char ch = *m_pCurrent++;
+		if (ch == '"')
+		{
+			return true;
+		}
+		if (ch != '\\' || m_pCurrent >= m_pEnd)
+		{
+			// ַвδתĿַ
+			return false;
+		}
+		ch = *m_pCurrent++;
+		switch (ch)
+		{
+		case '"':
+		case '\\':
+		case '/':
+			break;
+		case 'b':
+			ch = '\b';
+			break;
+		case 'f':
+			ch = '\f';
+			break;
+		case 'n':
+			ch = '\n';
+			break;
+		case 'r':
+			ch = '\r';
+			break;
+		case 't':
+			ch = '\t';
+			break;
+		case 'u':
+		{
+			uint32 nCode = 0;
+			if (!readHex(nCode))
+			{
+				return false;
+			}
+			if (nCode >= 0xD800 && nCode <= 0xDBFF)
+			{
+				// 
+				uint32 nLow = 0;
+				if (m_pEnd - m_pCurrent < 2 || m_pCurrent[0] != '\\' || m_pCurrent[1] != 'u')
+				{
+					return false;
+				}
+				m_pCurrent += 2;
+				if (!readHex(nLow) || nLow < 0xDC00 || nLow > 0xDFFF)
+				{
+					return false;
+				}
+				nCode = 0x10000 + ((nCode - 0xD800) << 10) + (nLow - 0xDC00);
+			}
+			else if (nCode >= 0xDC00 && nCode <= 0xDFFF)
+			{
+				return false;
+			}
+			if (pValue)
+			{
+				// תΪUTF-8
+				if (nCode < 0x80)
+				{
+					pValue->push_back(char(nCode));
+				}
+				else if (nCode < 0x800)
+				{
+					pValue->push_back(char(0xC0 | (nCode >> 6)));
+					pValue->push_back(char(0x80 | (nCode & 0x3F)));
+				}
+				else if (nCode < 0x10000)
+				{
+					pValue->push_back(char(0xE0 | (nCode >> 12)));
+					pValue->push_back(char(0x80 | ((nCode >> 6) & 0x3F)));
+					pValue->push_back(char(0x80 | (nCode & 0x3F)));
+				}
+				else
+				{
+					pValue->push_back(char(0xF0 | (nCode >> 18)));
+					pValue->push_back(char(0x80 | ((nCode >> 12) & 0x3F)));
+					pValue->push_back(char(0x80 | ((nCode >> 6) & 0x3F)));
+					pValue->push_back(char(0x80 | (nCode & 0x3F)));
+				}
+			}
+			continue;
+		}
+		default:
+			return false;
+		}
+		if (pValue)
+		{
+			pValue->push_back(ch);
+		}
+	}
+}
+
+bool SerializedJsonReader::readNumber()
+{
+	const char* pNumber = m_pCurrent;
+	const char* p = m_pCurrent;
+	if (p < m_pEnd && *p == '-')
+	{
+		p++;
+	}
+	if (p >= m_pEnd || !isDigit(*p))
+	{
+		return false;
+	}
+	if (*p == '0')
+	{
+		p++;
+	}
+	else
+	{
+		while (p < m_pEnd && isDigit(*p))
+			p++;
+	}
+	bool bInteger = true;
+	if (p < m_pEnd && *p == '.')
+	{
+		bInteger = false;
+		const char* pDigits = ++p;
+		while (p < m_pEnd && isDigit(*p))
+			p++;
+		if (p == pDigits)
+			return false;
+	}
+	if (p < m_pEnd && (*p == 'e' || *p == 'E'))
+	{
+		bInteger = false;
+		p++;
+		if (p < m_pEnd && (*p == '+' || *p == '-'))
+			p++;
+		const char* pDigits = p;
+		while (p < m_pEnd && isDigit(*p))
+			p++;
+		if (p == pDigits)
+			return false;
+	}
+	m_pCurrent = p;
+	if (m_bCounting)
+	{
+		return true;
+	}
+
+	uint32 nLength = uint32(p - pNumber);
+	int64 nValue = 0;
+	if (bInteger && SerializedKey::parseInteger(pNumber, nLength, nValue))
+	{
+		m_writer.writeInt(nValue);
+		return true;
+	}
+	if (bInteger && nLength == 2 && pNumber[0] == '-')
+	{
+		// "-0"
+		m_writer.writeInt(0);
+		return true;
+	}
+	// С򳬳int64Χ(json_decodeһתΪ); 벻һ'\0'β, ȸ
+	char szBuffer[64];
+	if (nLength < sizeof(szBuffer))
+	{
+		memcpy(szBuffer, pNumber, nLength);
+		szBuffer[nLength] = 0;
+		m_writer.writeDouble(strtod(szBuffer, 0));
+	}
+	else
+	{
+		m_writer.writeDouble(strtod(String(pNumber, nLength).c_str(), 0));
+	}
+	return true;
+}
+
+bool SerializedJsonReader::readLiteral(const char* szLiteral, int32 nLength)
+{
+	if (m_pEnd - m_pCurrent < nLength || memcmp(m_pCurrent, szLiteral, nLength) != 0)
+	{
+		return false;
+	}
+	m_pCurrent += nLength;
+	return true;
+}
+
+} // namespace
+
+
+//////////////////////////////////////////////////////////////////////////
+
+
+static void appendJsonValue(String& strOutput, const SerializedValue& value)
+{
+	const char* pBegin = 0;
+	const char* pEnd = 0;
+	switch (value.type())
+	{
+	case intValue:
+		appendJsonInteger(strOutput, value.asInt64());
+		break;
+	case realValue:
+		appendJsonDouble(strOutput, value.asDouble());
+		break;
+	case booleanValue:
+		if (value.asBool())
+			strOutput.append("true", 4);
+		else
+			strOutput.append("false", 5);
+		break;
+	case stringValue:
+	case customValue:
+	case enumValue:
+		value.getString(&pBegin, &pEnd);
+		appendJsonString(strOutput, pBegin, pEnd - pBegin);
+		break;
+	case arrayValue:
+	case objectValue:
+	{
+		bool bList = value.isArray();
+		int64 nExpected = 0;
+		for (SerializedValue::const_iterator it = value.begin(); bList && it != value.end(); ++it)
+		{
+			bList = it.key().isInt() && it.key().intValue() == nExpected++;
+		}
+		strOutput.push_back(bList ? '[' : '{');
+		for (SerializedValue::const_iterator it = value.begin(); it != value.end(); ++it)
+		{
+			if (it != value.begin())
+			{
+				strOutput.push_back(',');
+			}
+			if (!bList)
+			{
+				if (it.key().isInt())
+				{
+					strOutput.push_back('"');
+					appendJsonInteger(strOutput, it.key().intValue());
+					strOutput.push_back('"');
+				}
+				else
+				{
+					appendJsonString(strOutput, it.key().name(), it.key().nameLength());
+				}
+				strOutput.push_back(':');
+			}
+			appendJsonValue(strOutput, it.value());
+		}
+		strOutput.push_back(bList ? ']' : '}');
+	}
+	break;
+	default:
+		strOutput.append("null", 4);
+		break;
+	}
+}
+
+bool SerializedPhpJson::toJson(const char* pData, int32 nLength, String& strOutput)
+{
+	strOutput.reserve(strOutput.length() + nLength);
+	SerializedJsonEmitter emitter(pData, pData + nLength, strOutput);
+	return emitter.emit();
+}
+
+bool SerializedPhpJson::toJson(const String& strInput, String& strOutput)
+{
+	return toJson(strInput.data(), int32(strInput.length()), strOutput);
+}
+
+void SerializedPhpJson::toJson(const SerializedValue& value, String& strOutput)
+{
+	appendJsonValue(strOutput, value);
+}
+
+bool SerializedPhpJson::fromJson(const char* pData, int32 nLength, String& strOutput)
+{
+	strOutput.reserve(strOutput.length() + nLength);
+	SerializedJsonReader reader(pData, pData + nLength, strOutput);
+	return reader.read();
+}
+
+bool SerializedPhpJson::fromJson(const String& strInput, String& strOutput)
+{
+	return fromJson(strInput.data(), int32(strInput.length()), strOutput);
+}
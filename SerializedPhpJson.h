@@ -0,0 +1,45 @@
+/**********************************************************************
+* Copyright (C) 2018 - tx7do - All Rights Reserved
+*
+* ļ:		SerializedPhpJson.h
+* ժ    Ҫ:		PHPлJSONת
+*
+*     :		yanglinbo,
+*     :		鿴ļ·.
+*
+***********************************************************************/
+
+#ifndef __SerializedPhpJson_H__
+#define __SerializedPhpJson_H__
+
+#include "SerializedPhpParser.h"
+
+
+//////////////////////////////////////////////////////////////////////////
+/// JSONת
+/// ֱлֽһɨJSON, SerializedValue:
+/// - Ϊ0..n-1Ұ˳еΪJSON, ͶΪJSON
+/// - ı/˽ȥɼǰ׺, 
+/// - R:/r:ֵJSON, ڵʱnull;
+///   ʹ64(ҳ1MB)ʱʧ
+/// - NAN/INFnull, C:غַ, öö
+/// ַUTF-8ԭ, ֻתַ'"''\'.
+/// JSONתлʽʱתΪ, json_decode($json, true)һ.
+//////////////////////////////////////////////////////////////////////////
+class SerializedPhpJson
+{
+public:
+	/// ʧʱfalse, ʱstrOutput׷ӵݲ
+	static bool toJson(const char* pData, int32 nLength, String& strOutput);
+	static bool toJson(const String& strInput, String& strOutput);
+
+	/// ѽõֵתΪJSON, ͬ
+	static void toJson(const SerializedValue& value, String& strOutput);
+
+	/// JSONתΪPHPлʽ, JSONϷʱfalse
+	static bool fromJson(const char* pData, int32 nLength, String& strOutput);
+	static bool fromJson(const String& strInput, String& strOutput);
+};
+
+
+#endif
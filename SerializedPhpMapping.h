@@ -0,0 +1,598 @@
+/**********************************************************************
+* Copyright (C) 2018 - tx7do - All Rights Reserved
+*
+* ļ:		SerializedPhpMapping.h
+* ժ    Ҫ:		PHPлC++ṹֶӳ
+*
+*     :		yanglinbo,
+*     :		鿴ļ·.
+*
+***********************************************************************/
+
+#ifndef __SerializedPhpMapping_H__
+#define __SerializedPhpMapping_H__
+
+#include "SerializedPhpParser.h"
+
+#include <type_traits>
+#if __cplusplus >= 201703L
+#include <optional>
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////
+/// ɵļǰ׺ s:len:"key";
+//////////////////////////////////////////////////////////////////////////
+template<size_t... I>
+struct SerializedPhpIndexSequence
+{
+};
+
+template<size_t N, size_t... I>
+struct SerializedPhpMakeIndexSequence : SerializedPhpMakeIndexSequence<N - 1, N - 1, I...>
+{
+};
+
+template<size_t... I>
+struct SerializedPhpMakeIndexSequence<0, I...>
+{
+	typedef SerializedPhpIndexSequence<I...> type;
+};
+
+struct SerializedPhpKeyTraits
+{
+	static constexpr size_t digits(size_t n)
+	{
+		return n < 10 ? 1 : 1 + digits(n / 10);
+	}
+
+	static constexpr size_t power10(size_t n)
+	{
+		return n == 0 ? 1 : 10 * power10(n - 1);
+	}
+};
+
+template<size_t N>
+struct SerializedPhpKey
+{
+	static const size_t keyLength = N - 1;
+	static const size_t digits = SerializedPhpKeyTraits::digits(N - 1);
+	static const size_t length = keyLength + digits + 6;
+
+	char data[length];
+
+	const char* key() const { return data + digits + 4; }
+
+	static constexpr SerializedPhpKey make(const char (&key)[N])
+	{
+		return SerializedPhpKey(key, typename SerializedPhpMakeIndexSequence<length>::type());
+	}
+
+	template<size_t... I>
+	constexpr SerializedPhpKey(const char (&key)[N], SerializedPhpIndexSequence<I...>)
+		: data{ charAt(key, I)... }
+	{
+	}
+
+	static constexpr char charAt(const char (&key)[N], size_t i)
+	{
+		return i == 0 ? 's'
+			: i == 1 ? ':'
+			: i < 2 + digits ? char('0' + keyLength / SerializedPhpKeyTraits::power10(digits + 1 - i) % 10)
+			: i == 2 + digits ? ':'
+			: i == 3 + digits ? '"'
+			: i < 4 + digits + keyLength ? key[i - 4 - digits]
+			: i == 4 + digits + keyLength ? '"'
+			: ';';
+	}
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+/// ֶӳ
+///
+/// SERIALIZED_PHP_MAPPING_BEGIN(User)
+///		SERIALIZED_PHP_FIELD(id)
+///		SERIALIZED_PHP_FIELD_KEY(name, "user_name")
+/// SERIALIZED_PHP_MAPPING_END()
+///
+/// дȫ. ַ, ƥʱȱȽϳmemcmp,
+/// ڱ֪, ṹSerializedValue.
+/// SERIALIZED_PHP_OBJECT_MAPPING_BEGIN(User, "App\\User")ΪO:.
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+struct SerializedPhpMapping
+{
+	static const bool defined = false;
+};
+
+#define SERIALIZED_PHP_MAPPING_HEADER(Type, name) \
+	template<> \
+	struct SerializedPhpMapping<Type> \
+	{ \
+		static const bool defined = true; \
+		static const char* className() { return name; } \
+		template<class Visitor, class Object> \
+		static bool visit(Visitor& visitor, Object& object) \
+		{
+
+#define SERIALIZED_PHP_MAPPING_BEGIN(Type) \
+	SERIALIZED_PHP_MAPPING_HEADER(Type, 0)
+
+#define SERIALIZED_PHP_OBJECT_MAPPING_BEGIN(Type, name) \
+	SERIALIZED_PHP_MAPPING_HEADER(Type, name)
+
+#define SERIALIZED_PHP_FIELD(member) \
+	SERIALIZED_PHP_FIELD_KEY(member, #member)
+
+#define SERIALIZED_PHP_FIELD_KEY(member, key) \
+			{ \
+				static constexpr SerializedPhpKey<sizeof(key)> kKey = SerializedPhpKey<sizeof(key)>::make(key); \
+				if (visitor(kKey, object.member)) \
+				{ \
+					return true; \
+				} \
+			}
+
+#define SERIALIZED_PHP_MAPPING_END() \
+			return false; \
+		} \
+	};
+
+
+//////////////////////////////////////////////////////////////////////////
+/// ͻд
+//////////////////////////////////////////////////////////////////////////
+class SerializedPhpMapper
+{
+public:
+	/// ȡһֵ(ַ)value
+	template<class T>
+	static bool readValue(SerializedPhpScanner& scanner, T& value);
+
+	/// a:N:{...}  O:len:"Class":N:{...} ӳĽṹ
+	template<class T>
+	static bool readStruct(SerializedPhpScanner& scanner, char chType, T& object);
+
+	/// ӳĽṹ, ֶΪ Ԥɵļǰ׺ + ֵ
+	template<class T>
+	static void writeStruct(SerializedPhpWriter& writer, const T& object);
+
+	/// ȥ˽/ "\0Class\0" / "\0*\0" ǰ׺
+	static void stripVisibility(const char*& pKey, int32& nKeyLength)
+	{
+		if (nKeyLength == 0 || pKey[0] != '\0')
+		{
+			return;
+		}
+		const char* pEnd = static_cast<const char*>(memchr(pKey + 1, '\0', nKeyLength - 1));
+		if (pEnd == 0)
+		{
+			return;
+		}
+		nKeyLength -= int32(pEnd + 1 - pKey);
+		pKey = pEnd + 1;
+	}
+};
+
+class SerializedPhpFieldMatcher
+{
+public:
+	SerializedPhpFieldMatcher(SerializedPhpScanner& scanner, const char* pKey, int32 nKeyLength)
+		: m_scanner(scanner)
+		, m_pKey(pKey)
+		, m_nKeyLength(nKeyLength)
+		, m_bSucceeded(false)
+	{
+	}
+
+	template<class Key, class F>
+	bool operator()(const Key& key, F& field)
+	{
+		if (int32(Key::keyLength) != m_nKeyLength || memcmp(key.key(), m_pKey, Key::keyLength) != 0)
+		{
+			return false;
+		}
+		m_bSucceeded = SerializedPhpMapper::readValue(m_scanner, field);
+		return true;
+	}
+
+	bool succeeded() const { return m_bSucceeded; }
+
+private:
+	SerializedPhpScanner&	m_scanner;
+	const char*				m_pKey;
+	int32					m_nKeyLength;
+	bool					m_bSucceeded;
+};
+
+class SerializedPhpFieldCounter
+{
+public:
+	SerializedPhpFieldCounter()
+		: m_nCount(0)
+	{
+	}
+
+	template<class Key, class F>
+	bool operator()(const Key&, const F&)
+	{
+		++m_nCount;
+		return false;
+	}
+
+	int32 count() const { return m_nCount; }
+
+private:
+	int32	m_nCount;
+};
+
+class SerializedPhpFieldEmitter
+{
+public:
+	SerializedPhpFieldEmitter(SerializedPhpWriter& writer)
+		: m_writer(writer)
+	{
+	}
+
+	template<class Key, class F>
+	bool operator()(const Key& key, const F& field)
+	{
+		m_writer.writeRaw(key.data, int32(Key::length));
+		m_writer.write(field);
+		return false;
+	}
+
+private:
+	SerializedPhpWriter&	m_writer;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+/// ֶͶд, 'N'һɱֶԭֵ
+//////////////////////////////////////////////////////////////////////////
+template<class T, class Enable = void>
+struct SerializedPhpField
+{
+	static bool read(SerializedPhpScanner& scanner, char chType, T& value)
+	{
+		static_assert(SerializedPhpMapping<T>::defined, "type has no SERIALIZED_PHP_MAPPING");
+		return SerializedPhpMapper::readStruct(scanner, chType, value);
+	}
+
+	static void write(SerializedPhpWriter& writer, const T& value)
+	{
+		static_assert(SerializedPhpMapping<T>::defined, "type has no SERIALIZED_PHP_MAPPING");
+		SerializedPhpMapper::writeStruct(writer, value);
+	}
+};
+
+template<class T>
+struct SerializedPhpField<T, typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type>
+{
+	static bool read(SerializedPhpScanner& scanner, char chType, T& value)
+	{
+		int64 nValue = 0;
+		double fValue = 0;
+		switch (chType)
+		{
+		case 'N':
+			return true;
+		case 'i':
+		case 'b':
+			if (!scanner.readInteger(nValue, ';'))
+			{
+				return false;
+			}
+			value = T(nValue);
+			return true;
+		case 'd':
+			if (!scanner.readDouble(fValue))
+			{
+				return false;
+			}
+			value = T(fValue);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static void write(SerializedPhpWriter& writer, T value)
+	{
+		writer.writeInt(int64(value));
+	}
+};
+
+template<class T>
+struct SerializedPhpField<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+	static bool read(SerializedPhpScanner& scanner, char chType, T& value)
+	{
+		int64 nValue = 0;
+		double fValue = 0;
+		switch (chType)
+		{
+		case 'N':
+			return true;
+		case 'i':
+			if (!scanner.readInteger(nValue, ';'))
+			{
+				return false;
+			}
+			value = T(nValue);
+			return true;
+		case 'd':
+			if (!scanner.readDouble(fValue))
+			{
+				return false;
+			}
+			value = T(fValue);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static void write(SerializedPhpWriter& writer, T value)
+	{
+		writer.writeDouble(double(value));
+	}
+};
+
+template<>
+struct SerializedPhpField<bool>
+{
+	static bool read(SerializedPhpScanner& scanner, char chType, bool& value)
+	{
+		int64 nValue = 0;
+		switch (chType)
+		{
+		case 'N':
+			return true;
+		case 'b':
+		case 'i':
+			if (!scanner.readInteger(nValue, ';'))
+			{
+				return false;
+			}
+			value = nValue != 0;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	static void write(SerializedPhpWriter& writer, bool value)
+	{
+		writer.writeBool(value);
+	}
+};
+
+template<>
+struct SerializedPhpField<std::string>
+{
+	static bool read(SerializedPhpScanner& scanner, char chType, std::string& value)
+	{
+		const char* pData = 0;
+		int32 nLength = 0;
+		switch (chType)
+		{
+		case 'N':
+			return true;
+		case 's':
+			if (!scanner.readString(pData, nLength))
+			{
+				return false;
+			}
+			value.assign(pData, nLength);
+			return true;
+		case 'S':
+			return scanner.readEscapedString(&value);
+		default:
+			return false;
+		}
+	}
+
+	static void write(SerializedPhpWriter& writer, const std::string& value)
+	{
+		writer.writeString(value.data(), int32(value.length()));
+	}
+};
+
+template<class T, class A>
+struct SerializedPhpField<std::vector<T, A> >
+{
+	static bool read(SerializedPhpScanner& scanner, char chType, std::vector<T, A>& value)
+	{
+		if (chType == 'N')
+		{
+			return true;
+		}
+		int32 nCount = 0;
+		if (chType != 'a' || !scanner.readArrayBegin(nCount))
+		{
+			return false;
+		}
+		value.clear();
+		// ÿԪ "i:0;N;", ֹαļ¹
+		value.reserve(std::min(nCount, scanner.remaining() / 6));
+		for (int32 i = 0; i < nCount; i++)
+		{
+			// ֻܼΪ0..n-1б, 鲻ܰ˳װvector
+			char chKeyType = 0;
+			int64 nIndex = -1;
+			if (!scanner.readType(chKeyType) || chKeyType != 'i' || !scanner.readInteger(nIndex, ';') || nIndex != i)
+			{
+				return false;
+			}
+			T element = T();
+			if (!SerializedPhpMapper::readValue(scanner, element))
+			{
+				return false;
+			}
+			value.push_back(std::move(element));
+		}
+		return scanner.readEnd();
+	}
+
+	static void write(SerializedPhpWriter& writer, const std::vector<T, A>& value)
+	{
+		int32 nCount = int32(value.size());
+		writer.writeArrayBegin(nCount);
+		for (int32 i = 0; i < nCount; i++)
+		{
+			writer.writeInt(i);
+			SerializedPhpField<T>::write(writer, value[i]);
+		}
+		writer.writeEnd();
+	}
+};
+
+#if __cplusplus >= 201703L
+template<class T>
+struct SerializedPhpField<std::optional<T> >
+{
+	static bool read(SerializedPhpScanner& scanner, char chType, std::optional<T>& value)
+	{
+		if (chType == 'N')
+		{
+			value.reset();
+			return true;
+		}
+		value.emplace();
+		return SerializedPhpField<T>::read(scanner, chType, *value);
+	}
+
+	static void write(SerializedPhpWriter& writer, const std::optional<T>& value)
+	{
+		if (!value)
+		{
+			writer.writeNull();
+			return;
+		}
+		SerializedPhpField<T>::write(writer, *value);
+	}
+};
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////
+
+
+template<class T>
+bool SerializedPhpMapper::readValue(SerializedPhpScanner& scanner, T& value)
+{
+	char chType = 0;
+	if (!scanner.readType(chType))
+	{
+		return false;
+	}
+	return SerializedPhpField<T>::read(scanner, chType, value);
+}
+
+template<class T>
+bool SerializedPhpMapper::readStruct(SerializedPhpScanner& scanner, char chType, T& object)
+{
+	int32 nCount = 0;
+	const char* pClassName = 0;
+	int32 nClassNameLength = 0;
+	switch (chType)
+	{
+	case 'N':
+		return true;
+	case 'a':
+		if (!scanner.readArrayBegin(nCount))
+		{
+			return false;
+		}
+		break;
+	case 'O':
+		if (!scanner.readObjectBegin(pClassName, nClassNameLength, nCount))
+		{
+			return false;
+		}
+		break;
+	default:
+		return false;
+	}
+
+	for (int32 i = 0; i < nCount; i++)
+	{
+		char chKeyType = 0;
+		const char* pKey = 0;
+		int32 nKeyLength = 0;
+		int64 nIndex = 0;
+		if (!scanner.readType(chKeyType))
+		{
+			return false;
+		}
+		if (chKeyType == 's')
+		{
+			if (!scanner.readString(pKey, nKeyLength))
+			{
+				return false;
+			}
+			if (chType == 'O')
+			{
+				stripVisibility(pKey, nKeyLength);
+			}
+		}
+		else if (chKeyType != 'i' || !scanner.readInteger(nIndex, ';'))
+		{
+			return false;
+		}
+
+		// δļֱӰ
+		SerializedPhpFieldMatcher matcher(scanner, pKey, nKeyLength);
+		if (pKey == 0 || !SerializedPhpMapping<T>::visit(matcher, object))
+		{
+			if (!scanner.skipValue())
+			{
+				return false;
+			}
+		}
+		else if (!matcher.succeeded())
+		{
+			return false;
+		}
+	}
+	return scanner.readEnd();
+}
+
+template<class T>
+void SerializedPhpMapper::writeStruct(SerializedPhpWriter& writer, const T& object)
+{
+	SerializedPhpFieldCounter counter;
+	SerializedPhpMapping<T>::visit(counter, object);
+
+	const char* pClassName = SerializedPhpMapping<T>::className();
+	if (pClassName)
+	{
+		writer.writeObjectBegin(pClassName, int32(strlen(pClassName)), counter.count());
+	}
+	else
+	{
+		writer.writeArrayBegin(counter.count());
+	}
+
+	SerializedPhpFieldEmitter emitter(writer);
+	SerializedPhpMapping<T>::visit(emitter, object);
+	writer.writeEnd();
+}
+
+template<class T>
+bool SerializedPhpParser::parseTo(T& object)
+{
+	SerializedPhpScanner scanner(m_strInput.data(), m_strInput.data() + m_strInput.length());
+	return SerializedPhpMapper::readValue(scanner, object) && scanner.eof();
+}
+
+template<class T>
+void SerializedPhpWriter::write(const T& value)
+{
+	SerializedPhpField<T>::write(*this, value);
+}
+
+
+#endif
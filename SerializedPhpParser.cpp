@@ -10,954 +10,3163 @@
 ***********************************************************************/
 
 #include "SerializedPhpParser.h"
+#include "SerializedPhpIgbinary.h"
 
+#include <cfloat>
+
+#include <new>
+#include <unordered_map>
+
+// ַ: [ü][][ַ]['\0'], ֺ֧'\0'Ķ, ʱֻü;
+// ȵλʾפַ(SerializedInternTable), Ҳͷ
+static const unsigned int kStaticStringFlag = 0x80000000u;
+
+struct StringValueHeader
+{
+	std::atomic<unsigned int> refs_;
+	unsigned int length_;
+};
+static_assert(sizeof(StringValueHeader) == 2 * sizeof(unsigned int), "string header layout is shared with SerializedInternTable");
+
+static inline StringValueHeader* stringValueHeader(const char* value)
+{
+	return reinterpret_cast<StringValueHeader*>(const_cast<char*>(value) - sizeof(StringValueHeader));
+}
 static inline char* duplicateStringValue(const char* value, unsigned int length = -1)
 {
-	if (length == -1)
+	if (length == (unsigned int)-1)
 	{
 		length = (unsigned int)strlen(value);
 	}
-	char* newString = static_cast<char*>(::malloc(length + 1));
+	char* block = static_cast<char*>(::malloc(sizeof(StringValueHeader) + length + 1));
+	StringValueHeader* header = new (block) StringValueHeader;
+	header->refs_.store(1, std::memory_order_relaxed);
+	header->length_ = length;
+	char* newString = block + sizeof(StringValueHeader);
 	memcpy(newString, value, length);
 	newString[length] = 0;
 	return newString;
 }
-static inline void releaseStringValue(char* value)
+static inline bool isStaticStringValue(const char* value)
 {
-	if (value) ::free(value);
+	return (stringValueHeader(value)->length_ & kStaticStringFlag) != 0;
 }
-
-const SerializedValue SerializedValue::null;
-
-SerializedValue::SerializedValue(SerializedValueType type /*= nullValue*/)
+static inline unsigned int stringValueLength(const char* value)
 {
-	type_ = type;
-
-	switch (type)
-	{
-	case nullValue:
-		break;
-	case intValue:
-		value_.int_ = 0;
-		break;
-	case realValue:
-		value_.real_ = 0.0;
-		break;
-	case stringValue:
-		value_.string_ = 0;
-		break;
-	case arrayValue:
-	case objectValue:
-		value_.map_ = new ObjectValues();
-		break;
-	case booleanValue:
-		value_.bool_ = false;
-		break;
-	default:
-		assert(false);
-	}
+	return value ? stringValueHeader(value)->length_ & ~kStaticStringFlag : 0;
 }
-
-SerializedValue::SerializedValue(int32 value)
+static inline char* copyStringValue(const char* value)
 {
-	type_ = intValue;
-	value_.int_ = value;
+	if (value && !isStaticStringValue(value))
+		stringValueHeader(value)->refs_.fetch_add(1, std::memory_order_relaxed);
+	return const_cast<char*>(value);
 }
-
-SerializedValue::SerializedValue(int64 value)
+static inline void releaseStringValue(char* value)
 {
-	type_ = intValue;
-	value_.int_ = value;
+	if (value == 0 || isStaticStringValue(value))
+		return;
+	StringValueHeader* header = stringValueHeader(value);
+	if (header->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		header->~StringValueHeader();
+		::free(header);
+	}
 }
-
-SerializedValue::SerializedValue(uint32 value)
+static inline uint32 hashStringValue(const char* value, uint32 length)
 {
-	type_ = intValue;
-	value_.int_ = value;
+	// FNV-1a
+	uint32 hash = 2166136261u;
+	for (uint32 i = 0; i < length; i++)
+	{
+		hash ^= uint8(value[i]);
+		hash *= 16777619u;
+	}
+	return hash;
 }
-
-SerializedValue::SerializedValue(uint64 value)
+static inline uint64 hashBytes64(const char* value, uint32 length)
 {
-	type_ = intValue;
-	value_.int_ = value;
+	// 64λFNV-1a
+	uint64 hash = 14695981039346656037ull;
+	for (uint32 i = 0; i < length; i++)
+	{
+		hash ^= uint8(value[i]);
+		hash *= 1099511628211ull;
+	}
+	return hash;
 }
-
-SerializedValue::SerializedValue(float value)
+static inline uint64 mixHash(uint64 hash, uint64 value)
 {
-	type_ = realValue;
-	value_.real_ = value;
+	hash = (hash ^ value) * 0x9E3779B97F4A7C15ull;
+	return hash ^ (hash >> 29);
 }
-
-SerializedValue::SerializedValue(double value)
+static inline uint32 hashIntegerKey(int64 index)
 {
-	type_ = realValue;
-	value_.real_ = value;
+	uint64 hash = uint64(index) * 0x9E3779B97F4A7C15ull;
+	return uint32(hash >> 32);
 }
-
-SerializedValue::SerializedValue(const char *value)
+static inline int compareStringValues(const char* value, const char* other)
 {
-	type_ = stringValue;
-	value_.string_ = duplicateStringValue(value);
+	if (value == other)
+		return 0;
+	if (!value || !other)
+		return value ? 1 : -1;
+	unsigned int length = stringValueLength(value);
+	unsigned int otherLength = stringValueLength(other);
+	int delta = memcmp(value, other, std::min(length, otherLength));
+	if (delta)
+		return delta;
+	return length < otherLength ? -1 : (length > otherLength ? 1 : 0);
 }
 
-SerializedValue::SerializedValue(const char *beginValue, const char *endValue)
+SerializedKey::SerializedKey(int64 index)
+	: name_(0)
+	, index_(index)
+	, visibility_(publicVisibility)
 {
-	type_ = stringValue;
-	value_.string_ = duplicateStringValue(beginValue, (unsigned int)(endValue - beginValue));
 }
 
-SerializedValue::SerializedValue(const std::string& value)
+SerializedKey::SerializedKey(const char* name)
+	: name_(0)
+	, index_(0)
+	, visibility_(publicVisibility)
 {
-	type_ = stringValue;
-	value_.string_ = duplicateStringValue(value.c_str(), (unsigned int)value.length());
+	if (!parseInteger(name, uint32(strlen(name)), index_))
+	{
+		name_ = duplicateStringValue(name);
+	}
 }
 
-SerializedValue::SerializedValue(bool value)
+SerializedKey::SerializedKey(const String& name)
+	: name_(0)
+	, index_(0)
+	, visibility_(publicVisibility)
 {
-	type_ = booleanValue;
-	value_.bool_ = value;
+	if (!parseInteger(name.data(), uint32(name.length()), index_))
+	{
+		name_ = duplicateStringValue(name.data(), (unsigned int)name.length());
+	}
 }
 
-SerializedValue::SerializedValue(const SerializedValue& other)
+SerializedKey::SerializedKey(const char* name, uint32 length, SerializedVisibility visibility, const SerializedClassName& scope)
+	: name_(0)
+	, index_(0)
+	, visibility_(visibility)
+	, scope_(scope)
 {
-	type_ = other.type_;
-	switch (type_)
+	if (visibility != publicVisibility || !parseInteger(name, length, index_))
 	{
-	case nullValue:
-	case intValue:
-	case realValue:
-	case booleanValue:
-		value_ = other.value_;
-		break;
-	case stringValue:
-		if (other.value_.string_)
-		{
-			value_.string_ = duplicateStringValue(other.value_.string_);
-			//allocated_ = true;
-		}
-		else
-			value_.string_ = 0;
-		break;
-	case arrayValue:
-	case objectValue:
-		value_.map_ = new ObjectValues(*other.value_.map_);
-		break;
-	default:
-		assert(false);
+		name_ = duplicateStringValue(name, length);
 	}
 }
 
-SerializedValue::~SerializedValue()
+SerializedKey::SerializedKey(const SerializedStaticString& name, SerializedVisibility visibility, const SerializedClassName& scope)
+	: name_(0)
+	, index_(0)
+	, visibility_(visibility)
+	, scope_(scope)
 {
-	switch (type_)
+	assert(name.c_str() != 0);
+	if (visibility != publicVisibility || !parseInteger(name.c_str(), stringValueLength(name.c_str()), index_))
 	{
-	case nullValue:
-	case intValue:
-	case realValue:
-	case booleanValue:
-		break;
-	case stringValue:
-		releaseStringValue(value_.string_);
-		break;
-	case arrayValue:
-	case objectValue:
-		delete value_.map_;
-		break;
-	default:
-		assert(false);
+		name_ = const_cast<char*>(name.c_str());
 	}
 }
 
-void SerializedValue::swap(SerializedValue &other)
+SerializedKey::SerializedKey(const SerializedKey& other)
+	: name_(copyStringValue(other.name_))
+	, index_(other.index_)
+	, visibility_(other.visibility_)
+	, scope_(other.scope_)
 {
-	SerializedValueType temp = type_;
-	type_ = other.type_;
-	other.type_ = temp;
-	std::swap(value_, other.value_);
 }
 
-SerializedValueType SerializedValue::type() const
+SerializedKey::~SerializedKey()
 {
-	return type_;
+	releaseStringValue(name_);
 }
 
-bool SerializedValue::operator>=(const SerializedValue &other) const
+SerializedKey& SerializedKey::operator=(const SerializedKey &other)
 {
-	return !(*this < other);
+	SerializedKey temp(other);
+	std::swap(name_, temp.name_);
+	index_ = temp.index_;
+	visibility_ = temp.visibility_;
+	scope_.swap(temp.scope_);
+	return *this;
 }
 
-bool SerializedValue::operator<=(const SerializedValue &other) const
+uint32 SerializedKey::nameLength() const
 {
-	return !(other < *this);
+	return stringValueLength(name_);
 }
 
-bool SerializedValue::operator<(const SerializedValue &other) const
+bool SerializedKey::parseInteger(const char* pData, uint32 nLength, int64& nIndex)
 {
-	int typeDelta = type_ - other.type_;
-	if (typeDelta)
-		return typeDelta < 0 ? true : false;
-	switch (type_)
+	// ͬPHPZEND_HANDLE_NUMERIC_STR: ǰ0, '+', "-0", int64Χ
+	const char* p = pData;
+	const char* pEnd = pData + nLength;
+	bool bNegative = p < pEnd && *p == '-';
+	if (bNegative)
+	{
+		p++;
+	}
+	if (p == pEnd || pEnd - p > 19 || *p < '0' || *p > '9' || (*p == '0' && (pEnd - p > 1 || bNegative)))
 	{
-	case nullValue:
 		return false;
-	case intValue:
-		return value_.int_ < other.value_.int_;
-	case realValue:
-		return value_.real_ < other.value_.real_;
-	case booleanValue:
-		return value_.bool_ < other.value_.bool_;
-	case stringValue:
-		return (value_.string_ == 0 && other.value_.string_)
-			|| (other.value_.string_
-				&&  value_.string_
-				&& strcmp(value_.string_, other.value_.string_) < 0);
-	case arrayValue:
-	case objectValue:
+	}
+	uint64 nValue = 0;
+	for (; p < pEnd; p++)
 	{
-		int delta = int(value_.map_->size() - other.value_.map_->size());
-		if (delta)
-			return delta < 0;
-		return (*value_.map_) < (*other.value_.map_);
+		if (*p < '0' || *p > '9')
+		{
+			return false;
+		}
+		nValue = nValue * 10 + uint64(*p - '0');
 	}
-	default:
-		assert(false);
+	if (nValue > 0x7FFFFFFFFFFFFFFFull + (bNegative ? 1 : 0))
+	{
+		return false;
 	}
-	return false;  // unreachable
-}
-
-bool SerializedValue::operator>(const SerializedValue &other) const
-{
-	return other < *this;
+	nIndex = bNegative ? int64(0 - nValue) : int64(nValue);
+	return true;
 }
 
-bool SerializedValue::operator==(const SerializedValue &other) const
+String SerializedKey::mangledName() const
 {
-	int temp = other.type_;
-	if (type_ != temp)
-		return false;
-	switch (type_)
+	if (isInt())
 	{
-	case nullValue:
-		return true;
-	case intValue:
-		return value_.int_ == other.value_.int_;
-	case realValue:
-		return value_.real_ == other.value_.real_;
-	case booleanValue:
-		return value_.bool_ == other.value_.bool_;
-	case stringValue:
-		return (value_.string_ == other.value_.string_)
-			|| (other.value_.string_
-				&&  value_.string_
-				&& strcmp(value_.string_, other.value_.string_) == 0);
-	case arrayValue:
-	case objectValue:
-		return value_.map_->size() == other.value_.map_->size()
-			&& (*value_.map_) == (*other.value_.map_);
+		char buffer[24];
+		return String(buffer, snprintf(buffer, sizeof(buffer), "%lld", (long long)index_));
+	}
+	String name(name_, nameLength());
+	switch (visibility_)
+	{
+	case protectedVisibility:
+		return String("\0*\0", 3) + name;
+	case privateVisibility:
+	{
+		String strMangled(1, '\0');
+		if (scope_)
+		{
+			strMangled += *scope_;
+		}
+		strMangled.push_back('\0');
+		return strMangled + name;
+	}
 	default:
-		assert(false);
+		return name;
 	}
-	return false;  // unreachable
 }
 
-bool SerializedValue::operator!=(const SerializedValue &other) const
+int SerializedKey::compare(const SerializedKey &other) const
 {
-	return !(*this == other);
+	// ֵǰ
+	if (isInt() || other.isInt())
+	{
+		if (isInt() != other.isInt())
+			return isInt() ? -1 : 1;
+		return index_ < other.index_ ? -1 : (index_ > other.index_ ? 1 : 0);
+	}
+	// ͬͬɼԵļ, еǰ; פļͬʱָͬ, ֽڱȽ
+	int delta = compareStringValues(name_, other.name_);
+	if (delta)
+		return delta;
+	if (visibility_ != other.visibility_)
+		return visibility_ < other.visibility_ ? -1 : 1;
+	if (scope_ == other.scope_)
+		return 0;
+	if (!scope_ || !other.scope_)
+		return !scope_ ? -1 : 1;
+	return *scope_ < *other.scope_ ? -1 : (*other.scope_ < *scope_ ? 1 : 0);
 }
 
-bool SerializedValue::operator!() const
+bool SerializedKey::operator<(const SerializedKey &other) const
 {
-	return isNull();
+	return compare(other) < 0;
 }
 
-void SerializedValue::clear()
+bool SerializedKey::operator==(const SerializedKey &other) const
 {
-	assert(type_ == nullValue || type_ == arrayValue || type_ == objectValue);
-
-	switch (type_)
-	{
-	case arrayValue:
-	case objectValue:
-		value_.map_->clear();
-		break;
-	default:
-		break;
-	}
+	return compare(other) == 0;
 }
 
-SerializedValue SerializedValue::key() const
+bool SerializedKey::operator!=(const SerializedKey &other) const
 {
-	return SerializedValue(0);
+	return !(*this == other);
 }
 
-uint32 SerializedValue::index() const
+bool SerializedKey::hasName(const char* name, uint32 length) const
 {
-	return uint32(-1);
+	return name_ && nameLength() == length && (name_ == name || memcmp(name_, name, length) == 0);
 }
 
-int SerializedValue::compare(const SerializedValue &other) const
+bool SerializedKey::hasSameName(const SerializedKey &other) const
 {
-	if (*this < other)
-		return -1;
-	if (*this > other)
-		return 1;
-	return 0;
+	if (isInt() || other.isInt())
+	{
+		return isInt() == other.isInt() && index_ == other.index_;
+	}
+	return hasName(other.name_, other.nameLength());
 }
 
-SerializedValue& SerializedValue::operator[](int32 index)
+//////////////////////////////////////////////////////////////////////////
+
+
+// ĿѰַ, ͬļֻǼǰһ()
+struct SerializedValue::KeyIndex
 {
-	assert(type_ == nullValue || type_ == arrayValue);
-	if (type_ == nullValue)
+	static uint32 hashOf(const SerializedKey& key)
 	{
-		*this = SerializedValue(arrayValue);
+		return key.isInt() ? hashIntegerKey(key.intValue()) : hashStringValue(key.name(), key.nameLength());
 	}
-	String key(StringUtility::toStringA(index));
-	ObjectValues::iterator it = value_.map_->lower_bound(key);
-	if (it != value_.map_->end() && (*it).first == key)
+
+	struct Slot
 	{
-		return (*it).second;
-	}
+		uint32 hash_;
+		const ObjectValues::value_type* entry_;
+	};
 
-	ObjectValues::value_type defaultValue(key, null);
-	it = value_.map_->insert(it, defaultValue);
-	return (*it).second;
-}
+	explicit KeyIndex(const ObjectValues& values)
+	{
+		uint32 size = 8;
+		while (size < values.size() * 2)
+		{
+			size <<= 1;
+		}
+		mask_ = size - 1;
+		Slot empty = { 0, 0 };
+		slots_.assign(size, empty);
+		for (ObjectValues::const_iterator it = values.begin(); it != values.end(); ++it)
+		{
+			const SerializedKey& key = (*it).first;
+			uint32 hash = hashOf(key);
+			uint32 i = hash & mask_;
+			while (slots_[i].entry_ && !slots_[i].entry_->first.hasSameName(key))
+			{
+				i = (i + 1) & mask_;
+			}
+			if (slots_[i].entry_ == 0)
+			{
+				slots_[i].hash_ = hash;
+				slots_[i].entry_ = &*it;
+			}
+		}
+	}
 
-const SerializedValue& SerializedValue::operator[](int32 index) const
-{
-	assert(type_ == nullValue || type_ == arrayValue);
-	if (type_ == nullValue)
+	const SerializedValue* find(const char* key, uint32 length) const
 	{
-		return null;
+		uint32 hash = hashStringValue(key, length);
+		for (uint32 i = hash & mask_; slots_[i].entry_; i = (i + 1) & mask_)
+		{
+			if (slots_[i].hash_ == hash && slots_[i].entry_->first.hasName(key, length))
+			{
+				return &slots_[i].entry_->second;
+			}
+		}
+		return 0;
 	}
-	String key(StringUtility::toStringA(index));
-	ObjectValues::const_iterator it = value_.map_->find(key);
-	if (it == value_.map_->end())
+
+	const SerializedValue* find(int64 index) const
 	{
-		return null;
+		uint32 hash = hashIntegerKey(index);
+		for (uint32 i = hash & mask_; slots_[i].entry_; i = (i + 1) & mask_)
+		{
+			const SerializedKey& key = slots_[i].entry_->first;
+			if (slots_[i].hash_ == hash && key.isInt() && key.intValue() == index)
+			{
+				return &slots_[i].entry_->second;
+			}
+		}
+		return 0;
 	}
-	return (*it).second;
-}
 
-SerializedValue& SerializedValue::operator[](const char* key)
-{
-	return resolveReference(key);
-}
+	uint32 mask_;
+	std::vector<Slot> slots_;
+};
 
-const SerializedValue& SerializedValue::operator[](const char* key) const
+// C:/öݶü, ֵʱֻӼ, ޸ǰٸ(дʱ)
+struct SerializedValue::ObjectData
 {
-	assert(type_ == nullValue || type_ == objectValue || type_ == arrayValue);
-	if (type_ == nullValue)
+	ObjectData() : refs_(1), index_(0), hash_(0) {}
+	ObjectData(const ObjectData& other) : refs_(1), values_(other.values_), className_(other.className_), index_(0), hash_(0)
 	{
-		return null;
+		// ĳԱ˳ͬ, бһεõɳԱ³ԱĶӦ
+		std::unordered_map<const ObjectMember*, ObjectMember*> members(values_.size());
+		ObjectValues::iterator it = values_.begin();
+		for (ObjectValues::const_iterator src = other.values_.begin(); src != other.values_.end(); ++src, ++it)
+		{
+			members[&*src] = &*it;
+		}
+		order_.reserve(other.order_.size());
+		for (size_t i = 0; i < other.order_.size(); i++)
+		{
+			order_.push_back(members[other.order_[i]]);
+		}
 	}
-	ObjectValues::const_iterator it = value_.map_->find(key);
-	if (it == value_.map_->end())
+	~ObjectData() { delete index_.load(std::memory_order_relaxed); }
+
+	void clear()
 	{
-		return null;
+		delete index_.exchange(0, std::memory_order_relaxed);
+		order_.clear();
+		values_.clear();
 	}
-	return (*it).second;
-}
 
-SerializedValue& SerializedValue::operator[](const std::string& key)
-{
-	return (*this)[key.c_str()];
-}
+	std::atomic<int32> refs_;
+	ObjectValues values_;
+	std::vector<ObjectMember*> order_;	///< ˳ָvalues_еĳԱ
+	SerializedClassName className_;
+	std::atomic<KeyIndex*> index_;	///< freeze()ʱ, ɾԱʱ
+	std::atomic<uint64> hash_;		///< freeze()ʱ, ֻSerializedDocument::hash()ȡ
+};
 
-const SerializedValue& SerializedValue::operator[](const std::string& key) const
+struct SerializedValue::NamedStringData
 {
-	return (*this)[key.c_str()];
-}
+	NamedStringData() : refs_(1), string_(0) {}
+	~NamedStringData() { releaseStringValue(string_); }
 
-bool SerializedValue::isNull() const
-{
-	return type_ == nullValue;
-}
+	std::atomic<int32> refs_;
+	char* string_;
+	SerializedClassName className_;
+};
 
-bool SerializedValue::isBool() const
+template<class T>
+static inline T* retainShared(T* data)
 {
-	return type_ == booleanValue;
+	if (data)
+		data->refs_.fetch_add(1, std::memory_order_relaxed);
+	return data;
 }
 
-bool SerializedValue::isInt() const
+template<class T>
+static inline void releaseShared(T* data)
 {
-	return type_ == intValue;
+	if (data && data->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		delete data;
 }
 
-bool SerializedValue::isIntegral() const
+static inline const char* classNameOf(const SerializedValue& value)
 {
-	return type_ == intValue
-		|| type_ == booleanValue;
+	const char* className = value.className();
+	return className ? className : "";
 }
 
-bool SerializedValue::isDouble() const
-{
-	return type_ == realValue;
-}
+static_assert(sizeof(SerializedValue) == 16, "SerializedValue should stay a 16-byte node");
 
-bool SerializedValue::isNumeric() const
+const SerializedValue SerializedValue::null;
+
+static const SerializedValue::ObjectValues& emptyObjectValues()
 {
-	return isIntegral() || isDouble();
+	static const SerializedValue::ObjectValues values;
+	return values;
 }
 
-bool SerializedValue::isString() const
+static const SerializedClassName& emptyClassName()
 {
-	return type_ == stringValue;
+	static const SerializedClassName className;
+	return className;
 }
 
-bool SerializedValue::isArray() const
+void SerializedValue::setTag(SerializedValueType type, uint32 shortLength /*= 0*/)
 {
-	return type_ == nullValue || type_ == arrayValue;
+	bytes_[15] = char(uint8(type) | uint8(shortLength << kLengthShift));
 }
 
-bool SerializedValue::isObject() const
+void SerializedValue::initString(const char* value, uint32 length)
 {
-	return type_ == nullValue || type_ == objectValue;
+	if (length <= kShortStringCapacity)
+	{
+		memcpy(bytes_, value, length);
+		bytes_[length] = 0;
+		setTag(stringValue, length);
+	}
+	else
+	{
+		value_.string_ = duplicateStringValue(value, length);
+		setTag(stringValue, kHeapString);
+	}
 }
 
-const char * SerializedValue::asCString() const
+bool SerializedValue::isShortString() const
 {
-	assert(type_ == stringValue);
-	return value_.string_;
+	return type() == stringValue && (uint8(bytes_[15]) >> kLengthShift) != kHeapString;
 }
 
-std::string SerializedValue::asString() const
+const char* SerializedValue::stringData(uint32& length) const
 {
-	switch (type_)
+	switch (type())
 	{
-	case nullValue:
-		return "";
 	case stringValue:
-		return value_.string_ ? value_.string_ : "";
-	case booleanValue:
-		return value_.bool_ ? "true" : "false";
-	case intValue:
-	case realValue:
-	case arrayValue:
-	case objectValue:
+		if (isShortString())
+		{
+			length = uint8(bytes_[15]) >> kLengthShift;
+			return bytes_;
+		}
+		length = stringValueLength(value_.string_);
+		return value_.string_;
+	case customValue:
+	case enumValue:
+		length = stringValueLength(value_.named_->string_);
+		return value_.named_->string_;
 	default:
-		break;
+		length = 0;
+		return 0;
 	}
-	return ""; // unreachable
 }
 
-int32 SerializedValue::asInt() const
+void SerializedValue::releasePayload()
 {
-	switch (type_)
+	switch (type())
 	{
-	case nullValue:
-		return 0;
-	case intValue:
-		return int32(value_.int_);
-	case realValue:
-		return int32(value_.real_);
-	case booleanValue:
-		return value_.bool_ ? 1 : 0;
 	case stringValue:
+		if (!isShortString())
+			releaseStringValue(value_.string_);
+		break;
+	case customValue:
+	case enumValue:
+		releaseShared(value_.named_);
+		break;
 	case arrayValue:
 	case objectValue:
-		assert(false);
+		releaseShared(value_.object_);
+		break;
 	default:
-		assert(false);
+		break;
 	}
-	return 0; // unreachable;
 }
 
-uint32 SerializedValue::asUInt() const
+SerializedValue::ObjectData* SerializedValue::mutableObject()
 {
-	switch (type_)
+	assert(type() == arrayValue || type() == objectValue);
+	if (value_.object_ == 0)
 	{
-	case nullValue:
-		return 0;
-	case intValue:
-		return uint32(value_.int_);
-	case realValue:
-		return uint32(value_.real_);
-	case booleanValue:
-		return value_.bool_ ? 1 : 0;
-	case stringValue:
-	case arrayValue:
-	case objectValue:
-		assert(false);
-	default:
-		assert(false);
+		value_.object_ = new ObjectData();
 	}
-	return 0; // unreachable;
+	else if (value_.object_->refs_.load(std::memory_order_acquire) != 1)
+	{
+		ObjectData* object = new ObjectData(*value_.object_);
+		releaseShared(value_.object_);
+		value_.object_ = object;
+	}
+	// ռʱֱ޸; ʱȻЧ, ɾԱʱŶ
+	return value_.object_;
 }
 
-int64 SerializedValue::asInt64() const
+SerializedValue::SerializedValue(SerializedValueType type /*= nullValue*/)
 {
-	switch (type_)
+	memset(bytes_, 0, sizeof(bytes_));
+	setTag(type);
+
+	switch (type)
 	{
 	case nullValue:
-		return 0;
+	case referenceValue:
 	case intValue:
-		return int64(value_.int_);
 	case realValue:
-		return int64(value_.real_);
 	case booleanValue:
-		return value_.bool_ ? 1 : 0;
 	case stringValue:
+		break;
 	case arrayValue:
 	case objectValue:
-		assert(false);
+		// , һԱʱٷ
+		value_.object_ = 0;
+		break;
+	case customValue:
+	case enumValue:
+		value_.named_ = new NamedStringData();
+		value_.named_->string_ = duplicateStringValue("", 0);
+		break;
 	default:
 		assert(false);
 	}
-	return 0; // unreachable;
 }
 
-uint64 SerializedValue::asUInt64() const
+SerializedValue::SerializedValue(int32 value)
 {
-	switch (type_)
-	{
-	case nullValue:
-		return 0;
-	case intValue:
-		return uint64(value_.int_);
-	case realValue:
-		return uint64(value_.real_);
-	case booleanValue:
-		return value_.bool_ ? 1 : 0;
-	case stringValue:
-	case arrayValue:
-	case objectValue:
-		assert(false);
-	default:
-		assert(false);
-	}
-	return 0; // unreachable;
+	value_.int_ = value;
+	setTag(intValue);
 }
 
-float SerializedValue::asFloat() const
+SerializedValue::SerializedValue(int64 value)
 {
-	switch (type_)
-	{
-	case nullValue:
-		return 0.0f;
-	case intValue:
-		return static_cast<float>(value_.int_);
-	case realValue:
-		return float(value_.real_);
-	case booleanValue:
-		return value_.bool_ ? 1.0f : 0.0f;
-	case stringValue:
-	case arrayValue:
-	case objectValue:
-		assert(false);
-	default:
-		assert(false);
-	}
-	return 0; // unreachable;
+	value_.int_ = value;
+	setTag(intValue);
 }
 
-double SerializedValue::asDouble() const
+SerializedValue::SerializedValue(uint32 value)
 {
-	switch (type_)
-	{
-	case nullValue:
-		return 0.0;
-	case intValue:
-		return static_cast<double>(value_.int_);
-	case realValue:
-		return value_.real_;
-	case booleanValue:
-		return value_.bool_ ? 1.0 : 0.0;
-	case stringValue:
-	case arrayValue:
-	case objectValue:
-		assert(false);
-	default:
-		assert(false);
-	}
-	return 0; // unreachable;
+	value_.int_ = value;
+	setTag(intValue);
 }
 
-bool SerializedValue::asBool() const
+SerializedValue::SerializedValue(uint64 value)
 {
-	switch (type_)
-	{
-	case nullValue:
-		return false;
-	case intValue:
-	case realValue:
-		return value_.real_ != 0.0;
-	case booleanValue:
-		return value_.bool_;
-	case stringValue:
-		return value_.string_  &&  value_.string_[0] != 0;
-	case arrayValue:
-	case objectValue:
-		return value_.map_->size() != 0;
-	default:
-		assert(false);
-	}
-	return false; // unreachable;
+	value_.int_ = value;
+	setTag(intValue);
 }
 
-int32 SerializedValue::size() const
+SerializedValue::SerializedValue(float value)
 {
-	switch (type_)
-	{
-	case nullValue:
-	case intValue:
-	case realValue:
-	case booleanValue:
-	case stringValue:
-		return 0;
-	case arrayValue:  // size of the array is highest index + 1
-	case objectValue:
-		return int32(value_.map_->size());
-	default:
-		assert(false);
-	}
-	return 0; // unreachable;
+	value_.real_ = value;
+	setTag(realValue);
 }
 
-bool SerializedValue::empty() const
+SerializedValue::SerializedValue(double value)
 {
-	if (isNull() || isArray() || isObject())
-		return size() == 0u;
-	else
-		return false;
+	value_.real_ = value;
+	setTag(realValue);
 }
 
-SerializedValue& SerializedValue::resolveReference(const char* key)
+SerializedValue::SerializedValue(const char *value)
 {
-	assert(type_ == nullValue || type_ == objectValue || type_ == arrayValue);
-	if (type_ == nullValue)
-	{
-		*this = SerializedValue(arrayValue);
-	}
-	ObjectValues::iterator it = value_.map_->lower_bound(key);
-	if (it != value_.map_->end() && (*it).first == key)
-	{
-		return (*it).second;
-	}
+	initString(value, (uint32)strlen(value));
+}
 
-	ObjectValues::value_type defaultValue(key, null);
-	it = value_.map_->insert(it, defaultValue);
-	SerializedValue& value = (*it).second;
-	return value;
+SerializedValue::SerializedValue(const char *beginValue, const char *endValue)
+{
+	initString(beginValue, (uint32)(endValue - beginValue));
 }
 
-SerializedValue& SerializedValue::operator=(const SerializedValue &other)
+SerializedValue::SerializedValue(const std::string& value)
 {
-	SerializedValue temp(other);
-	swap(temp);
-	return *this;
+	initString(value.data(), (uint32)value.length());
 }
 
-//////////////////////////////////////////////////////////////////////////
+SerializedValue::SerializedValue(const SerializedStaticString& value)
+{
+	value_.string_ = const_cast<char*>(value.c_str());
+	setTag(stringValue, kHeapString);
+}
 
+SerializedValue::SerializedValue(bool value)
+{
+	value_.bool_ = value;
+	setTag(booleanValue);
+}
 
-SerializedPhpParser::SerializedPhpParser(const String& strInput)
+SerializedValue::SerializedValue(SerializedValueType type, const char *beginValue, const char *endValue, const SerializedClassName& className)
 {
-	m_strInput = strInput;
-	m_nInputLenght = m_strInput.length();
-	m_nIndex = 0;
+	assert(type == customValue || type == enumValue);
+	value_.named_ = new NamedStringData();
+	value_.named_->string_ = duplicateStringValue(beginValue, (unsigned int)(endValue - beginValue));
+	value_.named_->className_ = className;
+	setTag(type);
 }
 
-SerializedPhpParser::SerializedPhpParser(const String& strInput, bool bAssumeUTF8)
+SerializedValue::SerializedValue(const SerializedValue& other)
 {
-	m_strInput = strInput;
-	m_nInputLenght = m_strInput.length();
-	m_bAssumeUTF8 = bAssumeUTF8;
-	m_nIndex = 0;
+	memcpy(bytes_, other.bytes_, sizeof(bytes_));
+	switch (other.type())
+	{
+	case stringValue:
+		if (!other.isShortString())
+			value_.string_ = copyStringValue(other.value_.string_);
+		break;
+	case customValue:
+	case enumValue:
+		retainShared(value_.named_);
+		break;
+	case arrayValue:
+	case objectValue:
+		retainShared(value_.object_);
+		break;
+	default:
+		break;
+	}
 }
 
-SerializedPhpParser::~SerializedPhpParser()
+SerializedValue::~SerializedValue()
 {
+	releasePayload();
+}
 
+void SerializedValue::swap(SerializedValue &other)
+{
+	char temp[sizeof(bytes_)];
+	memcpy(temp, bytes_, sizeof(bytes_));
+	memcpy(bytes_, other.bytes_, sizeof(bytes_));
+	memcpy(other.bytes_, temp, sizeof(bytes_));
 }
 
-SerializedValue SerializedPhpParser::parse()
+SerializedValueType SerializedValue::type() const
 {
-	SerializedValue result = parseInternal(false);
-	cleanup();
-	return result;
+	return SerializedValueType(uint8(bytes_[15]) & kTypeMask);
 }
 
-void SerializedPhpParser::cleanup()
+bool SerializedValue::operator>=(const SerializedValue &other) const
 {
-	m_arrRef.clear();
+	return !(*this < other);
 }
 
-SerializedValue SerializedPhpParser::parseInternal(bool isKey)
+bool SerializedValue::operator<=(const SerializedValue &other) const
 {
-	checkUnexpectedLength(m_nIndex + 2);
+	return !(other < *this);
+}
 
-	char type = m_strInput[m_nIndex];
-	switch (type)
+bool SerializedValue::operator<(const SerializedValue &other) const
+{
+	return compare(other) < 0;
+}
+
+bool SerializedValue::operator>(const SerializedValue &other) const
+{
+	return compare(other) > 0;
+}
+
+bool SerializedValue::operator==(const SerializedValue &other) const
+{
+	if (type() != other.type())
+		return false;
+	switch (type())
 	{
-	case 'i':
+	case nullValue:
+	case referenceValue:
+		return true;
+	case intValue:
+		return value_.int_ == other.value_.int_;
+	case realValue:
+		return value_.real_ == other.value_.real_;
+	case booleanValue:
+		return value_.bool_ == other.value_.bool_;
+	case stringValue:
 	{
-		m_nIndex += 2;
-		return parseInt(isKey);
+		uint32 length = 0, otherLength = 0;
+		const char* data = stringData(length);
+		const char* otherData = other.stringData(otherLength);
+		return length == otherLength && (data == otherData || memcmp(data, otherData, length) == 0);
 	}
-	break;
-
-	case 'd':
+	case customValue:
+	case enumValue:
+		return strcmp(classNameOf(*this), classNameOf(other)) == 0
+			&& compareStringValues(value_.named_->string_, other.value_.named_->string_) == 0;
+	case arrayValue:
+	case objectValue:
 	{
-		m_nIndex += 2;
-		return parseFloat(isKey);
+		if (value_.object_ == other.value_.object_)
+			return true;
+		if (type() == objectValue && strcmp(classNameOf(*this), classNameOf(other)) != 0)
+			return false;
+		const ObjectValues& values = this->values();
+		const ObjectValues& otherValues = other.values();
+		if (values.size() != otherValues.size())
+			return false;
+		for (ObjectValues::const_iterator it = values.begin(), otherIt = otherValues.begin(); it != values.end(); ++it, ++otherIt)
+		{
+			if ((*it).first.compare((*otherIt).first) != 0 || !((*it).second == (*otherIt).second))
+				return false;
+		}
+		return true;
+	}
+	default:
+		assert(false);
+	}
+	return false;  // unreachable
+}
+
+bool SerializedValue::operator!=(const SerializedValue &other) const
+{
+	return !(*this == other);
+}
+
+bool SerializedValue::operator!() const
+{
+	return isNull();
+}
+
+void SerializedValue::clear()
+{
+	assert(type() == nullValue || type() == arrayValue || type() == objectValue);
+
+	switch (type())
+	{
+	case arrayValue:
+	case objectValue:
+		if (value_.object_)
+			mutableObject()->clear();
+		break;
+	default:
+		break;
+	}
+}
+
+SerializedValue SerializedValue::key() const
+{
+	return SerializedValue(0);
+}
+
+uint32 SerializedValue::index() const
+{
+	return uint32(-1);
+}
+
+bool SerializedValue::isCustom() const
+{
+	return type() == customValue;
+}
+
+bool SerializedValue::isEnum() const
+{
+	return type() == enumValue;
+}
+
+const char* SerializedValue::className() const
+{
+	const SerializedClassName& className = classNameRef();
+	return className ? className->c_str() : 0;
+}
+
+const SerializedClassName& SerializedValue::classNameRef() const
+{
+	switch (type())
+	{
+	case objectValue:
+		return value_.object_ ? value_.object_->className_ : emptyClassName();
+	case customValue:
+	case enumValue:
+		return value_.named_->className_;
+	default:
+		return emptyClassName();
+	}
+}
+
+void SerializedValue::setClassName(const SerializedClassName& className)
+{
+	assert(type() == objectValue || type() == customValue || type() == enumValue);
+	if (type() == objectValue)
+	{
+		if (value_.object_ == 0 && !className)
+			return;
+		mutableObject()->className_ = className;
+	}
+	else
+	{
+		if (value_.named_->refs_.load(std::memory_order_acquire) != 1)
+		{
+			NamedStringData* named = new NamedStringData();
+			named->string_ = copyStringValue(value_.named_->string_);
+			releaseShared(value_.named_);
+			value_.named_ = named;
+		}
+		value_.named_->className_ = className;
+	}
+}
+
+bool SerializedValue::isSharedWith(const SerializedValue& other) const
+{
+	if (type() != other.type())
+		return false;
+	switch (type())
+	{
+	case stringValue:
+		return !isShortString() && value_.string_ == other.value_.string_;
+	case customValue:
+	case enumValue:
+		return value_.named_ == other.value_.named_;
+	case arrayValue:
+	case objectValue:
+		return value_.object_ != 0 && value_.object_ == other.value_.object_;
+	default:
+		return false;
+	}
+}
+
+const SerializedValue::KeyIndex* SerializedValue::buildIndex() const
+{
+	const KeyIndex* index = value_.object_->index_.load(std::memory_order_acquire);
+	if (index == 0)
+	{
+		// ߳̿ͬʱͬһ, CAS, ʧܵһԼ
+		KeyIndex* created = new KeyIndex(value_.object_->values_);
+		KeyIndex* expected = 0;
+		if (value_.object_->index_.compare_exchange_strong(expected, created, std::memory_order_acq_rel))
+		{
+			index = created;
+		}
+		else
+		{
+			delete created;
+			index = expected;
+		}
+	}
+	return index;
+}
+
+void SerializedValue::buildIndexes(VisitedSet& visited) const
+{
+	if ((type() != arrayValue && type() != objectValue) || value_.object_ == 0)
+	{
+		return;
+	}
+	// ˵Ҳ(find()ᵥ), ¼Ƿʹ
+	if (!visited.insert(value_.object_).second)
+	{
+		return;
+	}
+	buildIndex();
+	const ObjectValues& values = value_.object_->values_;
+	for (ObjectValues::const_iterator it = values.begin(); it != values.end(); ++it)
+	{
+		(*it).second.buildIndexes(visited);
+	}
+	// ĹϣѾ, ֮ǰĿѹ, 
+	value_.object_->hash_.store(0, std::memory_order_relaxed);
+	value_.object_->hash_.store(hashValue(true), std::memory_order_relaxed);
+}
+
+const SerializedValue* SerializedValue::find(const char* key, uint32 length) const
+{
+	int64 integer = 0;
+	if (SerializedKey::parseInteger(key, length, integer))
+	{
+		return get(integer);
+	}
+	if ((type() != arrayValue && type() != objectValue) || value_.object_ == 0)
+	{
+		return 0;
+	}
+	const KeyIndex* index = value_.object_->index_.load(std::memory_order_acquire);
+	const ObjectValues& values = value_.object_->values_;
+	if (index == 0 && values.size() >= kIndexThreshold)
+	{
+		index = buildIndex();
+	}
+	if (index)
+	{
+		return index->find(key, length);
+	}
+	// Сֱɨ, ͬļǰ
+	for (ObjectValues::const_iterator it = values.begin(); it != values.end(); ++it)
+	{
+		if ((*it).first.hasName(key, length))
+		{
+			return &(*it).second;
+		}
+	}
+	return 0;
+}
+
+const SerializedValue* SerializedValue::find(const char* key) const
+{
+	return find(key, uint32(strlen(key)));
+}
+
+const SerializedValue* SerializedValue::find(const std::string& key) const
+{
+	return find(key.data(), uint32(key.length()));
+}
+
+const SerializedValue* SerializedValue::get(int64 index) const
+{
+	if ((type() != arrayValue && type() != objectValue) || value_.object_ == 0)
+	{
+		return 0;
+	}
+	const KeyIndex* keyIndex = value_.object_->index_.load(std::memory_order_acquire);
+	const ObjectValues& values = value_.object_->values_;
+	if (keyIndex == 0 && values.size() >= kIndexThreshold)
+	{
+		keyIndex = buildIndex();
+	}
+	if (keyIndex)
+	{
+		return keyIndex->find(index);
+	}
+	// ǰ
+	for (ObjectValues::const_iterator it = values.begin(); it != values.end() && (*it).first.isInt(); ++it)
+	{
+		if ((*it).first.intValue() == index)
+		{
+			return &(*it).second;
+		}
+	}
+	return 0;
+}
+
+SerializedDocument SerializedValue::freeze() const
+{
+	std::shared_ptr<const SerializedValue> root = std::make_shared<const SerializedValue>(*this);
+	VisitedSet visited;
+	root->buildIndexes(visited);
+	return SerializedDocument(root);
+}
+
+// ͬһݶַֻһ
+static inline size_t stringValueUsage(const char* value, std::unordered_set<const void*>& visited)
+{
+	if (value == 0 || isStaticStringValue(value) || !visited.insert(value).second)
+		return 0;
+	return sizeof(StringValueHeader) + stringValueLength(value) + 1;
+}
+
+size_t SerializedValue::memoryUsage() const
+{
+	VisitedSet visited;
+	return memoryUsage(visited);
+}
+
+size_t SerializedValue::memoryUsage(VisitedSet& visited) const
+{
+	switch (type())
+	{
+	case stringValue:
+		return isShortString() ? 0 : stringValueUsage(value_.string_, visited);
+	case customValue:
+	case enumValue:
+		if (value_.named_ == 0 || !visited.insert(value_.named_).second)
+			return 0;
+		return sizeof(NamedStringData) + stringValueUsage(value_.named_->string_, visited);
+	case arrayValue:
+	case objectValue:
+	{
+		// ùֻһ
+		const ObjectData* data = value_.object_;
+		if (data == 0 || !visited.insert(data).second)
+			return 0;
+		size_t usage = sizeof(ObjectData) + data->order_.capacity() * sizeof(ObjectMember*);
+		for (ObjectValues::const_iterator it = data->values_.begin(); it != data->values_.end(); ++it)
+		{
+			// std::mapĽڵиָɫ
+			usage += sizeof(ObjectMember) + 4 * sizeof(void*);
+			usage += stringValueUsage((*it).first.name(), visited) + (*it).second.memoryUsage(visited);
+		}
+		const KeyIndex* index = data->index_.load(std::memory_order_acquire);
+		if (index)
+		{
+			usage += sizeof(KeyIndex) + index->slots_.capacity() * sizeof(KeyIndex::Slot);
+		}
+		return usage;
+	}
+	default:
+		return 0;
+	}
+}
+
+SerializedValue::const_iterator SerializedValue::begin() const
+{
+	if ((type() != arrayValue && type() != objectValue) || value_.object_ == 0)
+		return const_iterator();
+	return const_iterator(value_.object_->order_.data());
+}
+
+SerializedValue::const_iterator SerializedValue::end() const
+{
+	if ((type() != arrayValue && type() != objectValue) || value_.object_ == 0)
+		return const_iterator();
+	return const_iterator(value_.object_->order_.data() + value_.object_->order_.size());
+}
+
+SerializedValue::iterator SerializedValue::begin()
+{
+	if ((type() != arrayValue && type() != objectValue) || value_.object_ == 0)
+		return iterator();
+	return iterator(mutableObject()->order_.data());
+}
+
+SerializedValue::iterator SerializedValue::end()
+{
+	if ((type() != arrayValue && type() != objectValue) || value_.object_ == 0)
+		return iterator();
+	ObjectData* object = mutableObject();
+	return iterator(object->order_.data() + object->order_.size());
+}
+
+const SerializedValue::ObjectValues& SerializedValue::values() const
+{
+	if ((type() == arrayValue || type() == objectValue) && value_.object_)
+		return value_.object_->values_;
+	return emptyObjectValues();
+}
+
+SerializedValue::ObjectValues& SerializedValue::mutableValues()
+{
+	return mutableObject()->values_;
+}
+
+int SerializedValue::compare(const SerializedValue &other) const
+{
+	int typeDelta = type() - other.type();
+	if (typeDelta)
+		return typeDelta < 0 ? -1 : 1;
+	switch (type())
+	{
+	case nullValue:
+	case referenceValue:
+		return 0;
+	case intValue:
+		return value_.int_ < other.value_.int_ ? -1 : (value_.int_ > other.value_.int_ ? 1 : 0);
+	case realValue:
+		return value_.real_ < other.value_.real_ ? -1 : (value_.real_ > other.value_.real_ ? 1 : 0);
+	case booleanValue:
+		return int(value_.bool_) - int(other.value_.bool_);
+	case stringValue:
+	{
+		uint32 length = 0, otherLength = 0;
+		const char* data = stringData(length);
+		const char* otherData = other.stringData(otherLength);
+		int delta = data == otherData ? 0 : memcmp(data, otherData, std::min(length, otherLength));
+		if (delta)
+			return delta;
+		return length < otherLength ? -1 : (length > otherLength ? 1 : 0);
+	}
+	case customValue:
+	case enumValue:
+	{
+		int delta = strcmp(classNameOf(*this), classNameOf(other));
+		if (delta)
+			return delta;
+		return compareStringValues(value_.named_->string_, other.value_.named_->string_);
+	}
+	case arrayValue:
+	case objectValue:
+	{
+		if (value_.object_ == other.value_.object_)
+			return 0;
+		if (type() == objectValue)
+		{
+			int delta = strcmp(classNameOf(*this), classNameOf(other));
+			if (delta)
+				return delta;
+		}
+		const ObjectValues& values = this->values();
+		const ObjectValues& otherValues = other.values();
+		if (values.size() != otherValues.size())
+			return values.size() < otherValues.size() ? -1 : 1;
+		// ˳Ƚ, ÿԼֵֻȽһ
+		for (ObjectValues::const_iterator it = values.begin(), otherIt = otherValues.begin(); it != values.end(); ++it, ++otherIt)
+		{
+			int delta = (*it).first.compare((*otherIt).first);
+			if (delta == 0)
+				delta = (*it).second.compare((*otherIt).second);
+			if (delta)
+				return delta;
+		}
+		return 0;
+	}
+	default:
+		assert(false);
+	}
+	return 0;  // unreachable
+}
+
+static inline uint64 hashKey(const SerializedKey& key)
+{
+	if (key.isInt())
+		return mixHash(1, uint64(key.intValue()));
+	uint64 hash = mixHash(2, hashBytes64(key.name(), key.nameLength()));
+	hash = mixHash(hash, uint64(key.visibility()));
+	if (key.scope())
+		hash = mixHash(hash, hashBytes64(key.scope()->data(), uint32(key.scope()->length())));
+	return hash;
+}
+
+uint64 SerializedValue::hash() const
+{
+	return hashValue(false);
+}
+
+uint64 SerializedValue::hashValue(bool cached) const
+{
+	uint64 hash = mixHash(0, uint64(type()));
+	switch (type())
+	{
+	case intValue:
+		return mixHash(hash, uint64(value_.int_));
+	case realValue:
+	{
+		// 0.0 == -0.0
+		double real = value_.real_ == 0 ? 0.0 : value_.real_;
+		uint64 bits = 0;
+		memcpy(&bits, &real, sizeof(bits));
+		return mixHash(hash, bits);
+	}
+	case booleanValue:
+		return mixHash(hash, value_.bool_ ? 1 : 0);
+	case stringValue:
+	{
+		uint32 length = 0;
+		const char* data = stringData(length);
+		return mixHash(hash, hashBytes64(data, length));
+	}
+	case customValue:
+	case enumValue:
+	{
+		const char* className = classNameOf(*this);
+		hash = mixHash(hash, hashBytes64(className, uint32(strlen(className))));
+		return mixHash(hash, hashBytes64(value_.named_->string_, stringValueLength(value_.named_->string_)));
+	}
+	case arrayValue:
+	case objectValue:
+	{
+		// ޸ĺ޴ӵ֪, Ĺϣֻֻĵʹ
+		uint64 frozen = cached && value_.object_ ? value_.object_->hash_.load(std::memory_order_relaxed) : 0;
+		if (frozen)
+			return frozen;
+		// operator==һ, ˳, 
+		if (type() == objectValue)
+		{
+			const char* className = classNameOf(*this);
+			hash = mixHash(hash, hashBytes64(className, uint32(strlen(className))));
+		}
+		const ObjectValues& values = this->values();
+		hash = mixHash(hash, values.size());
+		for (ObjectValues::const_iterator it = values.begin(); it != values.end(); ++it)
+		{
+			hash = mixHash(hash, hashKey((*it).first));
+			hash = mixHash(hash, (*it).second.hashValue(cached));
+		}
+		return hash ? hash : 1;
+	}
+	default:
+		return hash;
+	}
+}
+
+SerializedValue& SerializedValue::operator[](int32 index)
+{
+	assert(type() == nullValue || type() == arrayValue);
+	if (type() == nullValue)
+	{
+		*this = SerializedValue(arrayValue);
+	}
+	SerializedKey key((int64)index);
+	ObjectValues& values = mutableValues();
+	ObjectValues::iterator it = values.lower_bound(key);
+	if (it != values.end() && (*it).first == key)
+	{
+		return (*it).second;
+	}
+
+	return insertMember(it, key);
+}
+
+const SerializedValue& SerializedValue::operator[](int32 index) const
+{
+	assert(type() == nullValue || type() == arrayValue);
+	if (type() == nullValue)
+	{
+		return null;
+	}
+	const SerializedValue* value = get(index);
+	return value ? *value : null;
+}
+
+SerializedValue& SerializedValue::operator[](const char* key)
+{
+	return resolveReference(key);
+}
+
+const SerializedValue& SerializedValue::operator[](const char* key) const
+{
+	assert(type() == nullValue || type() == objectValue || type() == arrayValue);
+	if (type() == nullValue)
+	{
+		return null;
+	}
+	// , ֿɼ
+	const SerializedValue* value = find(key);
+	return value ? *value : null;
+}
+
+SerializedValue& SerializedValue::operator[](const SerializedKey& key)
+{
+	assert(type() == nullValue || type() == objectValue || type() == arrayValue);
+	if (type() == nullValue)
+	{
+		*this = SerializedValue(arrayValue);
+	}
+	ObjectValues& values = mutableValues();
+	ObjectValues::iterator it = values.lower_bound(key);
+	if (it != values.end() && (*it).first == key)
+	{
+		return (*it).second;
+	}
+
+	return insertMember(it, key);
+}
+
+const SerializedValue& SerializedValue::operator[](const SerializedKey& key) const
+{
+	assert(type() == nullValue || type() == objectValue || type() == arrayValue);
+	if (type() == nullValue)
+	{
+		return null;
+	}
+	const ObjectValues& values = this->values();
+	ObjectValues::const_iterator it = values.find(key);
+	if (it == values.end())
+	{
+		return null;
+	}
+	return (*it).second;
+}
+
+SerializedValue& SerializedValue::operator[](const std::string& key)
+{
+	return (*this)[key.c_str()];
+}
+
+const SerializedValue& SerializedValue::operator[](const std::string& key) const
+{
+	assert(type() == nullValue || type() == objectValue || type() == arrayValue);
+	const SerializedValue* value = find(key);
+	return value ? *value : null;
+}
+
+bool SerializedValue::isNull() const
+{
+	return type() == nullValue;
+}
+
+bool SerializedValue::isBool() const
+{
+	return type() == booleanValue;
+}
+
+bool SerializedValue::isInt() const
+{
+	return type() == intValue;
+}
+
+bool SerializedValue::isIntegral() const
+{
+	return type() == intValue
+		|| type() == booleanValue;
+}
+
+bool SerializedValue::isDouble() const
+{
+	return type() == realValue;
+}
+
+bool SerializedValue::isNumeric() const
+{
+	return isIntegral() || isDouble();
+}
+
+bool SerializedValue::isString() const
+{
+	return type() == stringValue;
+}
+
+bool SerializedValue::isArray() const
+{
+	return type() == nullValue || type() == arrayValue;
+}
+
+bool SerializedValue::isObject() const
+{
+	return type() == nullValue || type() == objectValue;
+}
+
+const char * SerializedValue::asCString() const
+{
+	assert(type() == stringValue || type() == customValue || type() == enumValue);
+	uint32 length = 0;
+	return stringData(length);
+}
+
+bool SerializedValue::getString(const char** begin, const char** end) const
+{
+	uint32 length = 0;
+	const char* data = stringData(length);
+	if (data == 0)
+		return false;
+	*begin = data;
+	*end = data + length;
+	return true;
+}
+
+std::string SerializedValue::asString() const
+{
+	switch (type())
+	{
+	case nullValue:
+		return "";
+	case stringValue:
+	case enumValue:
+	{
+		uint32 length = 0;
+		const char* data = stringData(length);
+		return std::string(data, length);
+	}
+	case booleanValue:
+		return value_.bool_ ? "true" : "false";
+	case intValue:
+	case realValue:
+	case arrayValue:
+	case objectValue:
+	default:
+		break;
+	}
+	return ""; // unreachable
+}
+
+int32 SerializedValue::asInt() const
+{
+	switch (type())
+	{
+	case nullValue:
+		return 0;
+	case intValue:
+		return int32(value_.int_);
+	case realValue:
+		return int32(value_.real_);
+	case booleanValue:
+		return value_.bool_ ? 1 : 0;
+	case stringValue:
+	case arrayValue:
+	case objectValue:
+		assert(false);
+	default:
+		assert(false);
+	}
+	return 0; // unreachable;
+}
+
+uint32 SerializedValue::asUInt() const
+{
+	switch (type())
+	{
+	case nullValue:
+		return 0;
+	case intValue:
+		return uint32(value_.int_);
+	case realValue:
+		return uint32(value_.real_);
+	case booleanValue:
+		return value_.bool_ ? 1 : 0;
+	case stringValue:
+	case arrayValue:
+	case objectValue:
+		assert(false);
+	default:
+		assert(false);
+	}
+	return 0; // unreachable;
+}
+
+int64 SerializedValue::asInt64() const
+{
+	switch (type())
+	{
+	case nullValue:
+		return 0;
+	case intValue:
+		return int64(value_.int_);
+	case realValue:
+		return int64(value_.real_);
+	case booleanValue:
+		return value_.bool_ ? 1 : 0;
+	case stringValue:
+	case arrayValue:
+	case objectValue:
+		assert(false);
+	default:
+		assert(false);
+	}
+	return 0; // unreachable;
+}
+
+uint64 SerializedValue::asUInt64() const
+{
+	switch (type())
+	{
+	case nullValue:
+		return 0;
+	case intValue:
+		return uint64(value_.int_);
+	case realValue:
+		return uint64(value_.real_);
+	case booleanValue:
+		return value_.bool_ ? 1 : 0;
+	case stringValue:
+	case arrayValue:
+	case objectValue:
+		assert(false);
+	default:
+		assert(false);
+	}
+	return 0; // unreachable;
+}
+
+float SerializedValue::asFloat() const
+{
+	switch (type())
+	{
+	case nullValue:
+		return 0.0f;
+	case intValue:
+		return static_cast<float>(value_.int_);
+	case realValue:
+		return float(value_.real_);
+	case booleanValue:
+		return value_.bool_ ? 1.0f : 0.0f;
+	case stringValue:
+	case arrayValue:
+	case objectValue:
+		assert(false);
+	default:
+		assert(false);
+	}
+	return 0; // unreachable;
+}
+
+double SerializedValue::asDouble() const
+{
+	switch (type())
+	{
+	case nullValue:
+		return 0.0;
+	case intValue:
+		return static_cast<double>(value_.int_);
+	case realValue:
+		return value_.real_;
+	case booleanValue:
+		return value_.bool_ ? 1.0 : 0.0;
+	case stringValue:
+	case arrayValue:
+	case objectValue:
+		assert(false);
+	default:
+		assert(false);
+	}
+	return 0; // unreachable;
+}
+
+bool SerializedValue::asBool() const
+{
+	switch (type())
+	{
+	case nullValue:
+		return false;
+	case intValue:
+	case realValue:
+		return value_.real_ != 0.0;
+	case booleanValue:
+		return value_.bool_;
+	case stringValue:
+	{
+		uint32 length = 0;
+		const char* data = stringData(length);
+		return length != 0 && data[0] != 0;
+	}
+	case arrayValue:
+	case objectValue:
+		return values().size() != 0;
+	default:
+		assert(false);
+	}
+	return false; // unreachable;
+}
+
+int32 SerializedValue::size() const
+{
+	switch (type())
+	{
+	case nullValue:
+	case intValue:
+	case realValue:
+	case booleanValue:
+	case stringValue:
+		return 0;
+	case arrayValue:  // size of the array is highest index + 1
+	case objectValue:
+		return int32(values().size());
+	default:
+		assert(false);
+	}
+	return 0; // unreachable;
+}
+
+bool SerializedValue::empty() const
+{
+	if (isNull() || isArray() || isObject())
+		return size() == 0u;
+	else
+		return false;
+}
+
+SerializedValue& SerializedValue::resolveReference(const char* key)
+{
+	assert(type() == nullValue || type() == objectValue || type() == arrayValue);
+	if (type() == nullValue)
+	{
+		*this = SerializedValue(arrayValue);
+	}
+	// ͬı/˽ʱֱӷ
+	SerializedKey name(key);
+	ObjectValues& values = mutableValues();
+	ObjectValues::iterator it = values.lower_bound(name);
+	if (it != values.end() && (*it).first.hasSameName(name))
+	{
+		return (*it).second;
+	}
+
+	return insertMember(it, name);
+}
+
+SerializedValue& SerializedValue::insertMember(ObjectValues::iterator hint, const SerializedKey& key)
+{
+	// ǰѾmutableValues(), Ϊռ
+	ObjectData* object = value_.object_;
+	delete object->index_.exchange(0, std::memory_order_relaxed);
+	ObjectValues::iterator it = object->values_.insert(hint, ObjectValues::value_type(key, null));
+	object->order_.push_back(&*it);
+	return (*it).second;
+}
+
+SerializedValue& SerializedValue::operator=(const SerializedValue &other)
+{
+	SerializedValue temp(other);
+	swap(temp);
+	return *this;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+
+SerializedDocument::SerializedDocument()
+	: m_pRoot(std::make_shared<const SerializedValue>())
+{
+}
+
+SerializedDocument::SerializedDocument(const std::shared_ptr<const SerializedValue>& pRoot)
+	: m_pRoot(pRoot)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+
+SerializedPhpParser::SerializedPhpParser(const String& strInput)
+{
+	m_strInput = strInput;
+	m_nInputLenght = m_strInput.length();
+	m_bAssumeUTF8 = false;
+	m_nIndex = 0;
+	m_pInternTable = 0;
+}
+
+SerializedPhpParser::SerializedPhpParser(const String& strInput, bool bAssumeUTF8)
+{
+	m_strInput = strInput;
+	m_nInputLenght = m_strInput.length();
+	m_bAssumeUTF8 = bAssumeUTF8;
+	m_nIndex = 0;
+	m_pInternTable = 0;
+}
+
+SerializedPhpParser::~SerializedPhpParser()
+{
+
+}
+
+void SerializedPhpParser::setInternTable(SerializedInternTable* pTable)
+{
+	m_pInternTable = pTable;
+}
+
+bool SerializedPhpParser::parseIgbinary(SerializedValue& result)
+{
+	// igbinary԰汾ſͷ, ıʽ'\0'ͷ
+	if (m_nIndex != 0 || !SerializedPhpIgbinary::isIgbinary(m_strInput.data(), m_nInputLenght))
+	{
+		return false;
+	}
+	if (SerializedPhpIgbinary::decode(m_strInput.data(), m_nInputLenght, result, m_pInternTable))
+	{
+		m_nIndex = m_nInputLenght;
+	}
+	else
+	{
+		result = SerializedValue();
+	}
+	return true;
+}
+
+SerializedValue SerializedPhpParser::parse()
+{
+	SerializedValue result;
+	if (parseIgbinary(result))
+	{
+		return result;
+	}
+
+	result = parseInternal(false);
+	cleanup();
+	return result;
+}
+
+bool SerializedPhpParser::parseStep(int32 nBudget, SerializedValue& result)
+{
+	// parseInternalͬ﷨, /󲻵ݹ: δm_arrPending,
+	// Ԥʱֱӷ, ´εôջ. igbinaryֲܷ, һεü
+	if (m_arrPending.empty() && parseIgbinary(result))
+	{
+		return true;
+	}
+	int32 nStop = nBudget < m_nInputLenght - m_nIndex ? m_nIndex + nBudget : m_nInputLenght;
+	// ʽʱԱܲ(ԱܴĿ), ѭҲԤ
+	int32 nSteps = 0;
+	do
+	{
+		if (!m_arrPending.empty())
+		{
+			PendingContainer& top = m_arrPending.back();
+			if (top.nRemaining <= 0 || m_nIndex >= m_nInputLenght)
+			{
+				// 뱻ضʱҲ, û'}'Ϊnull
+				PendingContainer done = top;
+				m_arrPending.pop_back();
+				bool bClosed = done.bObject
+					? endObject(done.value, done.nRefSlot)
+					: endArray(done.value, done.nRefSlot);
+				if (!bClosed)
+				{
+					done.value = SerializedValue();
+				}
+				if (m_arrPending.empty())
+				{
+					result = done.value;
+					cleanup();
+					return true;
+				}
+				if (isAcceptedAttribute(done.key))
+				{
+					m_arrPending.back().value[done.key] = done.value;
+				}
+				continue;
+			}
+		}
+
+		bool bRoot = m_arrPending.empty();
+		SerializedKey key = bRoot ? SerializedKey(int64(0)) : parseKey(m_arrPending.back().bObject);
+		if (!bRoot)
+		{
+			m_arrPending.back().nRemaining--;
+		}
+
+		char type = m_nIndex < m_nInputLenght ? m_strInput[m_nIndex] : 0;
+		if (type == 'a' || type == 'O')
+		{
+			m_nIndex += 2;
+			m_arrPending.push_back(PendingContainer(key));
+			PendingContainer& pending = m_arrPending.back();
+			pending.bObject = type == 'O';
+			pending.nRemaining = pending.bObject
+				? beginObject(pending.value, pending.nRefSlot)
+				: beginArray(pending.value, pending.nRefSlot);
+			continue;
+		}
+
+		SerializedValue value = parseInternal(false);
+		if (bRoot)
+		{
+			result = value;
+			cleanup();
+			return true;
+		}
+		if (isAcceptedAttribute(key))
+		{
+			m_arrPending.back().value[key] = value;
+		}
+	} while (m_nIndex < nStop && ++nSteps < nBudget);
+	return false;
+}
+
+bool SerializedPhpParser::validate(const char* pData, int32 nLength, int32* pErrorOffset /*= 0*/)
+{
+	// ݹҲڴ: Ƕ׵öջ¼ʣļǺ(ֵһ)
+	int32 arrRemaining[kMaxValidateDepth];
+	int32 nDepth = 0;
+	int64 nSlots = 0;
+	SerializedPhpScanner scanner(pData, pData + nLength);
+	const char* pToken = pData;
+	for (;;)
+	{
+		pToken = scanner.current();
+		if (nDepth > 0 && arrRemaining[nDepth - 1] == 0)
+		{
+			if (!scanner.readEnd())
+			{
+				break;
+			}
+			if (--nDepth == 0)
+			{
+				pToken = scanner.current();
+				if (scanner.eof())
+				{
+					return true;
+				}
+				break;
+			}
+			continue;
+		}
+		bool bKey = nDepth > 0 && arrRemaining[nDepth - 1] % 2 == 0;
+		if (nDepth > 0)
+		{
+			arrRemaining[nDepth - 1]--;
+		}
+
+		char chType = 0;
+		if (!scanner.readType(chType))
+		{
+			break;
+		}
+		int64 nInt = 0;
+		double fReal = 0;
+		const char* pString = 0;
+		const char* pClassName = 0;
+		int32 nStringLength = 0;
+		int32 nCount = 0;
+		bool bValid = false;
+		if (bKey)
+		{
+			// ַֻ
+			if (chType == 'i')
+				bValid = scanner.readInteger(nInt, ';');
+			else if (chType == 's')
+				bValid = scanner.readString(pString, nStringLength);
+			else if (chType == 'S')
+				bValid = scanner.readEscapedString(0);
+			if (!bValid)
+			{
+				break;
+			}
+			continue;
+		}
+
+		if (chType != 'R')
+		{
+			nSlots++;
+		}
+		switch (chType)
+		{
+		case 'N':
+			bValid = true;
+			break;
+		case 'b':
+			bValid = scanner.readInteger(nInt, ';') && (nInt == 0 || nInt == 1);
+			break;
+		case 'i':
+			bValid = scanner.readInteger(nInt, ';');
+			break;
+		case 'd':
+			bValid = scanner.readDouble(fReal);
+			break;
+		case 's':
+			bValid = scanner.readString(pString, nStringLength);
+			break;
+		case 'S':
+			bValid = scanner.readEscapedString(0);
+			break;
+		case 'E':
+			bValid = scanner.readString(pString, nStringLength) && memchr(pString, ':', nStringLength) != 0;
+			break;
+		case 'C':
+			bValid = scanner.readCustom(pClassName, nStringLength, pString, nCount);
+			break;
+		case 'R':
+		case 'r':
+			// ֻѾֵֹ; r:ռһ, Լ
+			bValid = scanner.readInteger(nInt, ';') && nInt >= 1 && nInt < nSlots + (chType == 'R' ? 1 : 0);
+			break;
+		case 'a':
+		case 'O':
+			bValid = chType == 'a'
+				? scanner.readArrayBegin(nCount)
+				: scanner.readObjectBegin(pClassName, nStringLength, nCount);
+			// ÿԱҪ"i:0;N;"4ֽ, ԱԳʣ೤ʱֱΪ
+			if (!bValid || nCount > scanner.remaining() / 4 || nDepth >= kMaxValidateDepth)
+			{
+				bValid = false;
+				break;
+			}
+			arrRemaining[nDepth++] = nCount * 2;
+			continue;
+		default:
+			break;
+		}
+		if (!bValid)
+		{
+			break;
+		}
+		if (nDepth == 0)
+		{
+			pToken = scanner.current();
+			if (scanner.eof())
+			{
+				return true;
+			}
+			break;
+		}
+	}
+	if (pErrorOffset)
+	{
+		*pErrorOffset = int32(pToken - pData);
+	}
+	return false;
+}
+
+bool SerializedPhpParser::validate(const String& strInput, int32* pErrorOffset /*= 0*/)
+{
+	return validate(strInput.data(), int32(strInput.length()), pErrorOffset);
+}
+
+bool SerializedPhpParser::readSessionName(const char*& pName, int32& nLength)
+{
+	if (m_nIndex >= m_nInputLenght)
+	{
+		return false;
+	}
+	pName = m_strInput.data() + m_nIndex;
+	const char* pDelimiter = static_cast<const char*>(memchr(pName, '|', m_nInputLenght - m_nIndex));
+	if (pDelimiter == 0)
+	{
+		return false;
+	}
+	nLength = int32(pDelimiter - pName);
+	m_nIndex += nLength + 1;
+	return true;
+}
+
+SerializedValue SerializedPhpParser::parseSession()
+{
+	// ֮ûзָ, ÿֵȺн; m_arrRefڱ֮䱣
+	SerializedValue result(arrayValue);
+	const char* pName = 0;
+	int32 nLength = 0;
+	while (readSessionName(pName, nLength))
+	{
+		int32 nValueBegin = m_nIndex;
+		SerializedValue value = parseInternal(false);
+		result[makeKey(pName, nLength, publicVisibility, SerializedClassName())] = value;
+		if (m_nIndex <= nValueBegin)
+		{
+			break;
+		}
+	}
+	cleanup();
+	return result;
+}
+
+// һֵ, ķʽۼñ(ÿֵһ, R:ռ), еR:/r:ǷָǰnBaseֵ
+static bool skipSessionValue(SerializedPhpScanner& scanner, int64& nSlots, int64 nBase, bool& bOuterReference)
+{
+	char chType = 0;
+	if (!scanner.readType(chType))
+	{
+		return false;
+	}
+	if (chType != 'R')
+	{
+		nSlots++;
+	}
+
+	int64 nInt = 0;
+	double fReal = 0;
+	const char* pData = 0;
+	int32 nLength = 0;
+	int32 nCount = 0;
+	switch (chType)
+	{
+	case 'N':
+		return true;
+	case 'R':
+	case 'r':
+		if (!scanner.readInteger(nInt, ';'))
+		{
+			return false;
+		}
+		if (nInt <= nBase)
+		{
+			bOuterReference = true;
+		}
+		return true;
+	case 'i':
+	case 'b':
+		return scanner.readInteger(nInt, ';');
+	case 'd':
+		return scanner.readDouble(fReal);
+	case 's':
+	case 'E':
+		return scanner.readString(pData, nLength);
+	case 'S':
+		return scanner.readEscapedString(0);
+	case 'C':
+		return scanner.readCustom(pData, nLength, pData, nLength);
+	case 'a':
+		if (!scanner.readArrayBegin(nCount))
+		{
+			return false;
+		}
+		break;
+	case 'O':
+		if (!scanner.readObjectBegin(pData, nLength, nCount))
+		{
+			return false;
+		}
+		break;
+	default:
+		return false;
+	}
+
+	for (int32 i = 0; i < nCount; i++)
+	{
+		if (!scanner.skipValue() || !skipSessionValue(scanner, nSlots, nBase, bOuterReference))
+		{
+			return false;
+		}
+	}
+	return scanner.readEnd();
+}
+
+bool SerializedPhpParser::parseSessionVariable(const String& strName, SerializedValue& value)
+{
+	const char* pEnd = m_strInput.data() + m_nInputLenght;
+	const char* pName = 0;
+	int32 nLength = 0;
+	int64 nSlots = 0;
+	int64 nBase = 0;
+	int32 nTarget = -1;
+	bool bOuterReference = false;
+	m_nIndex = 0;
+	while (readSessionName(pName, nLength))
+	{
+		SerializedPhpScanner scanner(m_strInput.data() + m_nIndex, pEnd);
+		bool bTarget = size_t(nLength) == strName.length() && memcmp(pName, strName.data(), nLength) == 0;
+		nBase = nSlots;
+		if (!skipSessionValue(scanner, nSlots, bTarget ? nBase : 0, bOuterReference))
+		{
+			break;
+		}
+		if (bTarget)
+		{
+			nTarget = m_nIndex;
+			break;
+		}
+		m_nIndex += scanner.offset();
+	}
+	if (nTarget < 0)
+	{
+		m_nIndex = m_nInputLenght;
+		return false;
+	}
+
+	if (!bOuterReference)
+	{
+		// ǰֵᱻõ, ֻռλֱ
+		m_arrRef.resize(size_t(nBase));
+		m_nIndex = nTarget;
+		value = parseInternal(false);
+		cleanup();
+		return true;
+	}
+
+	m_nIndex = 0;
+	while (readSessionName(pName, nLength))
+	{
+		bool bTarget = m_nIndex == nTarget;
+		SerializedValue member = parseInternal(false);
+		if (bTarget)
+		{
+			value = member;
+			break;
+		}
+	}
+	cleanup();
+	return true;
+}
+
+void SerializedPhpParser::cleanup()
+{
+	m_arrRef.clear();
+	m_arrClassNames.clear();
+	m_arrPending.clear();
+}
+
+SerializedValue SerializedPhpParser::parseInternal(bool isKey)
+{
+	if (!checkUnexpectedLength(m_nIndex + 2))
+	{
+		m_nIndex = m_nInputLenght;
+		return SerializedValue();
+	}
+
+	char type = m_strInput[m_nIndex];
+	switch (type)
+	{
+	case 'i':
+	{
+		m_nIndex += 2;
+		return parseInt(isKey);
+	}
+	break;
+
+	case 'd':
+	{
+		m_nIndex += 2;
+		return parseFloat(isKey);
+	}
+	break;
+
+	case 'b':
+	{
+		m_nIndex += 2;
+		return parseBoolean();
+	}
+	break;
+
+	case 's':
+	{
+		m_nIndex += 2;
+		return parseString(isKey);
+	}
+	break;
+
+	case 'a':
+	{
+		m_nIndex += 2;
+		return parseArray();
+	}
+	break;
+
+	case 'O':
+	{
+		m_nIndex += 2;
+		return parseObject();
+	}
+	break;
+
+	case 'N':
+	{
+		m_nIndex += 2;
+		if (!isKey)
+		{
+			m_arrRef.push_back(SerializedValue());
+		}
+		return SerializedValue();
+	}
+	break;
+
+	case 'R':
+	case 'r':
+	{
+		m_nIndex += 2;
+		return parseReference(type == 'r');
+	}
+	break;
+
+	case 'S':
+	{
+		m_nIndex += 2;
+		return parseEscapedString(isKey);
+	}
+	break;
+
+	case 'C':
+	{
+		m_nIndex += 2;
+		return parseCustom();
+	}
+	break;
+
+	case 'E':
+	{
+		m_nIndex += 2;
+		return parseEnum();
+	}
+	break;
+
+	default:
+	{
+		return SerializedValue();
 	}
 	break;
+	}
+}
+
+SerializedValue SerializedPhpParser::parseInt(bool isKey)
+{
+	// int64ȡ, ضҲʱ
+	SerializedPhpScanner scanner(m_strInput.data() + m_nIndex, m_strInput.data() + m_nInputLenght);
+	int64 nValue = 0;
+	if (scanner.readInteger(nValue, ';'))
+	{
+		m_nIndex += scanner.offset();
+	}
+	else
+	{
+		int32 delimiter = m_strInput.find_first_of(';', m_nIndex);
+		if (delimiter == -1)
+		{
+			return SerializedValue(0);
+		}
+		checkUnexpectedLength(delimiter + 1);
+		m_nIndex = delimiter + 1;
+	}
+	SerializedValue value(nValue);
+	if (!isKey)
+	{
+		m_arrRef.push_back(value);
+	}
+	return value;
+}
+
+SerializedValue SerializedPhpParser::parseFloat(bool isKey)
+{
+	int32 delimiter = m_strInput.find_first_of(';', m_nIndex);
+	if (delimiter == -1)
+	{
+		return SerializedValue(0.0f);
+	}
+	checkUnexpectedLength(delimiter + 1);
+	String strValue = m_strInput.substr(m_nIndex, delimiter - m_nIndex);
+	double nValue = StringUtility::parseDouble(strValue);
+	SerializedValue value(nValue);
+	m_nIndex = delimiter + 1;
+	if (!isKey)
+	{
+		m_arrRef.push_back(value);
+	}
+	return value;
+}
+
+SerializedValue SerializedPhpParser::parseBoolean()
+{
+	int32 delimiter = m_strInput.find_first_of(';', m_nIndex);
+	if (delimiter == -1)
+	{
+		return SerializedValue(false);
+	}
+	checkUnexpectedLength(delimiter + 1);
+	String strValue = m_strInput.substr(m_nIndex, delimiter - m_nIndex);
+	bool nValue = StringUtility::parseBool(strValue);
+	SerializedValue value(nValue);
+	m_nIndex = delimiter + 1;
+	m_arrRef.push_back(value);
+	return value;
+}
+
+int32 SerializedPhpParser::readLength()
+{
+	int32 delimiter = m_strInput.find_first_of(':', m_nIndex);
+	if (delimiter == -1)
+	{
+		return 0;
+	}
+	if (!checkUnexpectedLength(delimiter + 2))
+	{
+		m_nIndex = m_nInputLenght;
+		return 0;
+	}
+	int32 arrayLen = StringUtility::parseInt32(m_strInput.substr(m_nIndex, delimiter - m_nIndex));
+	m_nIndex = delimiter + 2;
+	return arrayLen;
+}
+
+SerializedValue SerializedPhpParser::parseString(bool isKey)
+{
+	int32 strLen = readLength();
+	checkUnexpectedLength(strLen);
+
+	int32 utfStrLen = 0;
+	int32 byteCount = 0;
+	int32 nextCharIndex = 0;
+	while (byteCount != strLen)
+	{
+		nextCharIndex = m_nIndex + utfStrLen++;
+		if (nextCharIndex >= m_nInputLenght)
+		{
+			return SerializedValue("");
+		}
+		char ch = m_strInput[nextCharIndex];
+		if (m_bAssumeUTF8)
+		{
+			if ((ch >= 0x0000) && (ch <= 0x007F))
+			{
+				byteCount++;
+			}
+			else if (ch > 0x07FF)
+			{
+				byteCount += 3;
+			}
+			else
+			{
+				byteCount += 2;
+			}
+		}
+		else
+		{
+			byteCount++;
+		}
+	}
+	if ((m_nIndex + utfStrLen + 2) > m_nInputLenght
+		|| (m_nIndex + utfStrLen) > m_nInputLenght)
+	{
+		return SerializedValue("");
+	}
+	String endString = m_strInput.substr(m_nIndex + utfStrLen, 2);
+	if (!endString.compare("\";") == 0)
+	{
+		return SerializedValue("");
+	}
+
+	// ȷϸʽȷפ, פ̭, 벻±
+	String strValue = m_strInput.substr(m_nIndex, utfStrLen);
+	SerializedValue value;
+	SerializedStaticString interned;
+	if (m_pInternTable && (isKey || uint32(utfStrLen) <= m_pInternTable->maxLength()))
+	{
+		interned = m_pInternTable->intern(strValue.data(), uint32(strValue.length()));
+	}
+	if (!interned.isNull())
+	{
+		value = SerializedValue(interned);
+	}
+	else
+	{
+		value = SerializedValue(strValue);
+	}
+	m_nIndex = m_nIndex + utfStrLen + 2;
+	if (!isKey)
+	{
+		m_arrRef.push_back(value);
+	}
+	return value;
+}
 
-	case 'b':
+SerializedValue SerializedPhpParser::parseArray()
+{
+	SerializedValue result(arrayValue);
+	size_t nRefSlot = 0;
+	int32 arrayLen = beginArray(result, nRefSlot);
+
+	for (int i = 0; i < arrayLen; i++)
 	{
-		m_nIndex += 2;
-		return parseBoolean();
+		const auto& key = parseKey(false);
+		const auto& value = parseInternal(false);
+		if (isAcceptedAttribute(key))
+		{
+			result[key] = value;
+		}
 	}
-	break;
+	if (!endArray(result, nRefSlot))
+	{
+		return SerializedValue();
+	}
+	return result;
+}
 
-	case 's':
+SerializedValue SerializedPhpParser::parseObject()
+{
+	SerializedValue result(objectValue);
+	size_t nRefSlot = 0;
+	int32 attrLen = beginObject(result, nRefSlot);
+
+	for (int32 i = 0; i < attrLen; i++)
 	{
-		m_nIndex += 2;
-		return parseString(isKey);
+		const auto& key = parseKey(true);
+		const auto& value = parseInternal(false);
+		if (isAcceptedAttribute(key))
+		{
+			result[key] = value;
+		}
 	}
-	break;
+	if (!endObject(result, nRefSlot))
+	{
+		return SerializedValue();
+	}
+	return result;
+}
+
+int32 SerializedPhpParser::beginArray(SerializedValue& result, size_t& nRefSlot)
+{
+	int32 arrayLen = readLength();
+	checkUnexpectedLength(arrayLen);
+
+	result = SerializedValue(arrayValue);
+	nRefSlot = m_arrRef.size();
+	m_arrRef.push_back(result);
+	return arrayLen;
+}
+
+bool SerializedPhpParser::endArray(const SerializedValue& result, size_t nRefSlot)
+{
+	// ٵǼ, R:/r: ȡͬһ
+	m_arrRef[nRefSlot] = result;
+
+	if (m_nIndex >= m_nInputLenght || m_strInput[m_nIndex] != '}')
+	{
+		return false;
+	}
+	m_nIndex++;
+	return true;
+}
+
+int32 SerializedPhpParser::beginObject(SerializedValue& result, size_t& nRefSlot)
+{
+	result = SerializedValue(objectValue);
+	nRefSlot = m_arrRef.size();
+	m_arrRef.push_back(result);
+
+	int32 strLen = readLength();
+	// "\":"뷶Χ
+	if (strLen < 0 || m_nIndex + strLen + 2 > m_nInputLenght)
+	{
+		m_nIndex = m_nInputLenght;
+		return 0;
+	}
+	SerializedClassName className = internClassName(m_strInput.data() + m_nIndex, strLen);
+	m_nIndex = m_nIndex + strLen + 2;
+	int32 attrLen = readLength();
+
+	result.setClassName(className);
+	return attrLen;
+}
+
+bool SerializedPhpParser::endObject(const SerializedValue& result, size_t nRefSlot)
+{
+	return endArray(result, nRefSlot);
+}
+
+SerializedValue SerializedPhpParser::parseEscapedString(bool isKey)
+{
+	SerializedPhpScanner scanner(m_strInput.data() + m_nIndex, m_strInput.data() + m_nInputLenght);
+	String strValue;
+	if (!scanner.readEscapedString(&strValue))
+	{
+		m_nIndex = m_nInputLenght;
+		return SerializedValue("");
+	}
+	m_nIndex += scanner.offset();
+	SerializedValue value(strValue);
+	if (!isKey)
+	{
+		m_arrRef.push_back(value);
+	}
+	return value;
+}
+
+SerializedValue SerializedPhpParser::parseCustom()
+{
+	SerializedPhpScanner scanner(m_strInput.data() + m_nIndex, m_strInput.data() + m_nInputLenght);
+	const char* pClassName = 0;
+	int32 nClassNameLength = 0;
+	const char* pData = 0;
+	int32 nLength = 0;
+	if (!scanner.readCustom(pClassName, nClassNameLength, pData, nLength))
+	{
+		m_nIndex = m_nInputLenght;
+		return SerializedValue();
+	}
+	m_nIndex += scanner.offset();
+
+	// غɰ忽, ҪʱdecodeCustom
+	SerializedValue result(customValue, pData, pData + nLength, internClassName(pClassName, nClassNameLength));
+	m_arrRef.push_back(result);
+	return result;
+}
+
+SerializedValue SerializedPhpParser::parseEnum()
+{
+	SerializedPhpScanner scanner(m_strInput.data() + m_nIndex, m_strInput.data() + m_nInputLenght);
+	const char* pData = 0;
+	int32 nLength = 0;
+	if (!scanner.readString(pData, nLength))
+	{
+		m_nIndex = m_nInputLenght;
+		return SerializedValue();
+	}
+	m_nIndex += scanner.offset();
+
+	// "Class:Case"
+	const char* pSeparator = static_cast<const char*>(memchr(pData, ':', nLength));
+	if (pSeparator == 0)
+	{
+		// ռһñ, R:/r:Ųλ
+		m_arrRef.push_back(SerializedValue());
+		return SerializedValue();
+	}
+	SerializedValue result(enumValue, pSeparator + 1, pData + nLength, internClassName(pData, int32(pSeparator - pData)));
+	m_arrRef.push_back(result);
+	return result;
+}
+
+static std::map<String, SerializedCustomHandler>& customHandlers()
+{
+	static std::map<String, SerializedCustomHandler> handlers;
+	return handlers;
+}
+
+void SerializedPhpParser::registerCustomHandler(const String& className, SerializedCustomHandler handler)
+{
+	customHandlers()[className] = handler;
+}
+
+SerializedValue SerializedPhpParser::decodeCustom(const SerializedValue& custom)
+{
+	const char* pBegin = 0;
+	const char* pEnd = 0;
+	if (!custom.isCustom() || !custom.getString(&pBegin, &pEnd))
+	{
+		return custom;
+	}
+	std::map<String, SerializedCustomHandler>::const_iterator it = customHandlers().find(custom.className());
+	if (it == customHandlers().end())
+	{
+		return custom;
+	}
+	return it->second(custom.className(), pBegin, int32(pEnd - pBegin));
+}
+
+SerializedKey SerializedPhpParser::parseKey(bool isProperty)
+{
+	if (m_nIndex >= m_nInputLenght || m_strInput[m_nIndex] != 's')
+	{
+		SerializedValue key = parseInternal(true);
+		if (key.isNumeric())
+		{
+			return SerializedKey(key.asInt64());
+		}
+		const char* pBegin = 0;
+		const char* pEnd = 0;
+		if (!key.getString(&pBegin, &pEnd))
+		{
+			return SerializedKey("");
+		}
+		return SerializedKey(pBegin, uint32(pEnd - pBegin));
+	}
+
+	m_nIndex += 2;
+	int32 strLen = readLength();
+	if (strLen < 0 || m_nIndex + strLen + 2 > m_nInputLenght
+		|| m_strInput[m_nIndex + strLen] != '"' || m_strInput[m_nIndex + strLen + 1] != ';')
+	{
+		m_nIndex = m_nInputLenght;
+		return SerializedKey("");
+	}
+	const char* pName = m_strInput.data() + m_nIndex;
+	m_nIndex += strLen + 2;
+
+	// "\0*\0prop" Ϊ, "\0Class\0prop" Ϊ˽
+	const char* pScopeEnd = isProperty && strLen > 0 && pName[0] == '\0'
+		? static_cast<const char*>(memchr(pName + 1, '\0', strLen - 1))
+		: 0;
+	if (pScopeEnd == 0)
+	{
+		return makeKey(pName, strLen, publicVisibility, SerializedClassName());
+	}
+	const char* pPropertyName = pScopeEnd + 1;
+	int32 nPropertyLength = int32(pName + strLen - pPropertyName);
+	int32 nScopeLength = int32(pScopeEnd - pName - 1);
+	if (nScopeLength == 1 && pName[1] == '*')
+	{
+		return makeKey(pPropertyName, nPropertyLength, protectedVisibility, SerializedClassName());
+	}
+	return makeKey(pPropertyName, nPropertyLength, privateVisibility, internClassName(pName + 1, nScopeLength));
+}
+
+SerializedKey SerializedPhpParser::makeKey(const char* pName, int32 nLength, SerializedVisibility visibility, const SerializedClassName& scope)
+{
+	int64 nIndex = 0;
+	if (visibility == publicVisibility && SerializedKey::parseInteger(pName, nLength, nIndex))
+	{
+		return SerializedKey(nIndex);
+	}
+	if (m_pInternTable)
+	{
+		SerializedStaticString name = m_pInternTable->intern(pName, nLength);
+		if (!name.isNull())
+		{
+			return SerializedKey(name, visibility, scope);
+		}
+	}
+	return SerializedKey(pName, nLength, visibility, scope);
+}
+
+SerializedClassName SerializedPhpParser::internClassName(const char* pName, int32 nLength)
+{
+	// һĵֻͨм, ˳Ƚϼ, ʱڴ
+	for (size_t i = 0; i < m_arrClassNames.size(); i++)
+	{
+		const String& strName = *m_arrClassNames[i];
+		if (int32(strName.length()) == nLength && memcmp(strName.data(), pName, nLength) == 0)
+		{
+			return m_arrClassNames[i];
+		}
+	}
+	SerializedClassName className = std::make_shared<const String>(pName, nLength);
+	m_arrClassNames.push_back(className);
+	return className;
+}
+
+SerializedValue SerializedPhpParser::parseReference(bool bValueReference)
+{
+	int32 delimiter = m_strInput.find_first_of(';', m_nIndex);
+	if (delimiter == -1)
+	{
+		return SerializedValue(referenceValue);
+	}
+	checkUnexpectedLength(delimiter + 1);
+	// Ŵ1ʼ, 0ͳѽֵıЧ
+	int32 refNumber = StringUtility::parseInt32(m_strInput.substr(m_nIndex, delimiter - m_nIndex));
+	m_nIndex = delimiter + 1;
+	if (refNumber < 1 || size_t(refNumber) > m_arrRef.size())
+	{
+		return SerializedValue(referenceValue);
+	}
+	// PHPͬ: r:Ƶֵռһ, R:Ŀ깲ͬһֵ, ռ
+	auto value = m_arrRef[size_t(refNumber - 1)];
+	if (bValueReference)
+	{
+		m_arrRef.push_back(value);
+	}
+	return value;
+}
+
+bool SerializedPhpParser::checkUnexpectedLength(int32 newIndex)
+{
+	if (m_nIndex > m_nInputLenght || newIndex > m_nInputLenght)
+	{
+		return false;
+	}
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+
+SerializedPhpScanner::SerializedPhpScanner(const char* pBegin, const char* pEnd)
+	: m_pBegin(pBegin)
+	, m_pCurrent(pBegin)
+	, m_pEnd(pEnd)
+{
+}
+
+bool SerializedPhpScanner::expect(char ch)
+{
+	if (m_pCurrent >= m_pEnd || *m_pCurrent != ch)
+	{
+		return false;
+	}
+	++m_pCurrent;
+	return true;
+}
+
+bool SerializedPhpScanner::readType(char& chType)
+{
+	if (m_pEnd - m_pCurrent < 2)
+	{
+		return false;
+	}
+	chType = m_pCurrent[0];
+	char chDelimiter = chType == 'N' ? ';' : ':';
+	if (m_pCurrent[1] != chDelimiter)
+	{
+		return false;
+	}
+	m_pCurrent += 2;
+	return true;
+}
+
+bool SerializedPhpScanner::readInteger(int64& nValue, char chTerminator)
+{
+	const char* p = m_pCurrent;
+	bool bNegative = false;
+	if (p < m_pEnd && (*p == '-' || *p == '+'))
+	{
+		bNegative = *p == '-';
+		++p;
+	}
+	const char* pDigits = p;
+	// int64Χ, PHPһΪʽ
+	uint64 nLimit = 0x7FFFFFFFFFFFFFFFull + (bNegative ? 1 : 0);
+	uint64 nResult = 0;
+	while (p < m_pEnd && *p >= '0' && *p <= '9')
+	{
+		uint64 nDigit = uint64(*p - '0');
+		if (nResult > (nLimit - nDigit) / 10)
+		{
+			return false;
+		}
+		nResult = nResult * 10 + nDigit;
+		++p;
+	}
+	if (p == pDigits || p >= m_pEnd || *p != chTerminator)
+	{
+		return false;
+	}
+	nValue = bNegative ? int64(0 - nResult) : int64(nResult);
+	m_pCurrent = p + 1;
+	return true;
+}
+
+bool SerializedPhpScanner::readDouble(double& fValue)
+{
+	const char* pDelimiter = static_cast<const char*>(memchr(m_pCurrent, ';', m_pEnd - m_pCurrent));
+	if (pDelimiter == 0 || pDelimiter == m_pCurrent)
+	{
+		return false;
+	}
+	char* pParsed = 0;
+	fValue = strtod(m_pCurrent, &pParsed);
+	if (pParsed != pDelimiter)
+	{
+		return false;
+	}
+	m_pCurrent = pDelimiter + 1;
+	return true;
+}
+
+bool SerializedPhpScanner::readString(const char*& pData, int32& nLength)
+{
+	int64 nLen = 0;
+	if (!readInteger(nLen, ':') || nLen < 0 || !expect('"'))
+	{
+		return false;
+	}
+	if (nLen > (m_pEnd - m_pCurrent) - 2)
+	{
+		return false;
+	}
+	pData = m_pCurrent;
+	nLength = int32(nLen);
+	m_pCurrent += nLen;
+	return expect('"') && expect(';');
+}
+
+bool SerializedPhpScanner::readArrayBegin(int32& nCount)
+{
+	int64 nLen = 0;
+	if (!readInteger(nLen, ':') || nLen < 0 || nLen > 0x7FFFFFFF || !expect('{'))
+	{
+		return false;
+	}
+	nCount = int32(nLen);
+	return true;
+}
+
+bool SerializedPhpScanner::readObjectBegin(const char*& pClassName, int32& nClassNameLength, int32& nCount)
+{
+	int64 nLen = 0;
+	if (!readInteger(nLen, ':') || nLen < 0 || !expect('"'))
+	{
+		return false;
+	}
+	if (nLen > (m_pEnd - m_pCurrent) - 2)
+	{
+		return false;
+	}
+	pClassName = m_pCurrent;
+	nClassNameLength = int32(nLen);
+	m_pCurrent += nLen;
+	if (!expect('"') || !expect(':'))
+	{
+		return false;
+	}
+	return readArrayBegin(nCount);
+}
+
+bool SerializedPhpScanner::readEnd()
+{
+	return expect('}');
+}
 
-	case 'a':
+bool SerializedPhpScanner::readEscapedString(String* pValue)
+{
+	int64 nLen = 0;
+	if (!readInteger(nLen, ':') || nLen < 0 || !expect('"'))
 	{
-		m_nIndex += 2;
-		return parseArray();
+		return false;
 	}
-	break;
-
-	case 'O':
+	if (pValue)
 	{
-		m_nIndex += 2;
-		return parseObject();
+		pValue->clear();
+		pValue->reserve(size_t(std::min<int64>(nLen, m_pEnd - m_pCurrent)));
 	}
-	break;
-
-	case 'N':
+	for (int64 i = 0; i < nLen; i++)
 	{
-		m_nIndex += 2;
-		return nullptr;
+		if (m_pCurrent >= m_pEnd)
+		{
+			return false;
+		}
+		char ch = *m_pCurrent++;
+		if (ch == '\\')
+		{
+			// \xx Ϊʮתһֽ
+			if (m_pEnd - m_pCurrent < 2)
+			{
+				return false;
+			}
+			int nByte = 0;
+			for (int j = 0; j < 2; j++)
+			{
+				char chHex = *m_pCurrent++;
+				int nDigit = chHex >= '0' && chHex <= '9' ? chHex - '0'
+					: chHex >= 'a' && chHex <= 'f' ? chHex - 'a' + 10
+					: chHex >= 'A' && chHex <= 'F' ? chHex - 'A' + 10
+					: -1;
+				if (nDigit < 0)
+				{
+					return false;
+				}
+				nByte = nByte * 16 + nDigit;
+			}
+			ch = char(nByte);
+		}
+		if (pValue)
+		{
+			pValue->push_back(ch);
+		}
 	}
-	break;
+	return expect('"') && expect(';');
+}
 
-	case 'R':
+bool SerializedPhpScanner::readCustom(const char*& pClassName, int32& nClassNameLength, const char*& pData, int32& nLength)
+{
+	int64 nLen = 0;
+	if (!readInteger(nLen, ':') || nLen < 0 || !expect('"'))
 	{
-		m_nIndex += 2;
-		return parseReference();
+		return false;
 	}
-	break;
-
-	default:
+	if (nLen > (m_pEnd - m_pCurrent) - 2)
 	{
-		return SerializedValue();
+		return false;
 	}
-	break;
+	pClassName = m_pCurrent;
+	nClassNameLength = int32(nLen);
+	m_pCurrent += nLen;
+	if (!expect('"') || !expect(':') || !readInteger(nLen, ':') || nLen < 0 || !expect('{'))
+	{
+		return false;
+	}
+	if (nLen > (m_pEnd - m_pCurrent) - 1)
+	{
+		return false;
 	}
+	pData = m_pCurrent;
+	nLength = int32(nLen);
+	m_pCurrent += nLen;
+	return expect('}');
 }
 
-SerializedValue SerializedPhpParser::parseInt(bool isKey)
+bool SerializedPhpScanner::skipValue()
 {
-	int32 delimiter = m_strInput.find_first_of(';', m_nIndex);
-	if (delimiter == -1)
+	return skipValue(0);
+}
+
+bool SerializedPhpScanner::skipValue(int32 nDepth)
+{
+	char chType = 0;
+	if (!readType(chType))
 	{
-		return SerializedValue(0);
+		return false;
 	}
-	checkUnexpectedLength(delimiter + 1);
-	String strValue = m_strInput.substr(m_nIndex, delimiter - m_nIndex);
-	int32 nValue = StringUtility::parseInt32(strValue);
-	SerializedValue value(nValue);
-	m_nIndex = delimiter + 1;
-	if (!isKey)
+
+	int64 nInt = 0;
+	double fReal = 0;
+	const char* pData = 0;
+	int32 nLength = 0;
+	int32 nCount = 0;
+	switch (chType)
 	{
-		m_arrRef.push_back(value);
+	case 'N':
+		return true;
+	case 'i':
+	case 'b':
+	case 'R':
+	case 'r':
+		return readInteger(nInt, ';');
+	case 'd':
+		return readDouble(fReal);
+	case 's':
+	case 'E':
+		return readString(pData, nLength);
+	case 'S':
+		return readEscapedString(0);
+	case 'C':
+		return readCustom(pData, nLength, pData, nLength);
+	case 'a':
+		if (!readArrayBegin(nCount))
+		{
+			return false;
+		}
+		break;
+	case 'O':
+		if (!readObjectBegin(pData, nLength, nCount))
+		{
+			return false;
+		}
+		break;
+	default:
+		return false;
 	}
-	return value;
-}
 
-SerializedValue SerializedPhpParser::parseFloat(bool isKey)
-{
-	int32 delimiter = m_strInput.find_first_of(';', m_nIndex);
-	if (delimiter == -1)
+	if (++nDepth > kMaxDepth)
 	{
-		return SerializedValue(0.0f);
+		return false;
 	}
-	checkUnexpectedLength(delimiter + 1);
-	String strValue = m_strInput.substr(m_nIndex, delimiter - m_nIndex);
-	double nValue = StringUtility::parseDouble(strValue);
-	SerializedValue value(nValue);
-	m_nIndex = delimiter + 1;
-	if (!isKey)
+	for (int32 i = 0; i < nCount; i++)
 	{
-		m_arrRef.push_back(value);
+		if (!skipValue(nDepth) || !skipValue(nDepth))
+		{
+			return false;
+		}
 	}
-	return value;
+	return readEnd();
 }
 
-SerializedValue SerializedPhpParser::parseBoolean()
+//////////////////////////////////////////////////////////////////////////
+
+
+SerializedPhpWriter::SerializedPhpWriter(String& strOutput)
+	: m_strOutput(strOutput)
 {
-	int32 delimiter = m_strInput.find_first_of(';', m_nIndex);
-	if (delimiter == -1)
-	{
-		return SerializedValue(false);
-	}
-	checkUnexpectedLength(delimiter + 1);
-	String strValue = m_strInput.substr(m_nIndex, delimiter - m_nIndex);
-	bool nValue = StringUtility::parseBool(strValue);
-	SerializedValue value(nValue);
-	m_nIndex = delimiter + 1;
-	m_arrRef.push_back(value);
-	return value;
 }
 
-int32 SerializedPhpParser::readLength()
+void SerializedPhpWriter::writeNull()
 {
-	int32 delimiter = m_strInput.find_first_of(':', m_nIndex);
-	if (delimiter == -1)
-	{
-		return 0;
-	}
-	checkUnexpectedLength(delimiter + 2);
-	int32 arrayLen = StringUtility::parseInt32(m_strInput.substr(m_nIndex, delimiter - m_nIndex));
-	m_nIndex = delimiter + 2;
-	return arrayLen;
+	m_strOutput.append("N;", 2);
 }
 
-SerializedValue SerializedPhpParser::parseString(bool isKey)
+void SerializedPhpWriter::writeBool(bool bValue)
 {
-	int32 strLen = readLength();
-	checkUnexpectedLength(strLen);
+	m_strOutput.append(bValue ? "b:1;" : "b:0;", 4);
+}
 
-	int32 utfStrLen = 0;
-	int32 byteCount = 0;
-	int32 nextCharIndex = 0;
-	while (byteCount != strLen)
+void SerializedPhpWriter::writeInt(int64 nValue)
+{
+	m_strOutput.append("i:", 2);
+	writeDecimal(nValue);
+	m_strOutput.push_back(';');
+}
+
+int32 SerializedPhpWriter::formatDouble(double fValue, char* szBuffer, int32 nSize)
+{
+	// ЧλԽԽܻԭ, ֲܻԭԭֵλ, 17λܻԭ
+	int32 nLow = 1;
+	int32 nHigh = 17;
+	while (nLow < nHigh)
 	{
-		nextCharIndex = m_nIndex + utfStrLen++;
-		if (nextCharIndex >= m_nInputLenght)
+		int32 nPrecision = (nLow + nHigh) / 2;
+		snprintf(szBuffer, nSize, "%.*g", nPrecision, fValue);
+		if (strtod(szBuffer, 0) == fValue)
 		{
-			return SerializedValue("");
+			nHigh = nPrecision;
 		}
-		char ch = m_strInput[nextCharIndex];
-		if (m_bAssumeUTF8)
+		else
 		{
-			if ((ch >= 0x0000) && (ch <= 0x007F))
-			{
-				byteCount++;
-			}
-			else if (ch > 0x07FF)
-			{
-				byteCount += 3;
-			}
-			else
-			{
-				byteCount += 2;
-			}
+			nLow = nPrecision + 1;
 		}
-		else
+	}
+	int32 nLength = snprintf(szBuffer, nSize, "%.*g", nLow, fValue);
+	// λʱ%gָʽ, ָС15ʱԭ%.15gһдɶʽ
+	const char* pExponent = strchr(szBuffer, 'e');
+	if (pExponent)
+	{
+		int32 nExponent = atoi(pExponent + 1);
+		if (nExponent >= 0 && nExponent < 15)
 		{
-			byteCount++;
+			nLength = snprintf(szBuffer, nSize, "%.*g", nExponent + 1, fValue);
 		}
 	}
-	String strValue = m_strInput.substr(m_nIndex, utfStrLen);
-	SerializedValue value(strValue);
-	if ((m_nIndex + utfStrLen + 2) > m_nInputLenght
-		|| (m_nIndex + utfStrLen) > m_nInputLenght)
+	return nLength;
+}
+
+void SerializedPhpWriter::writeDouble(double fValue)
+{
+	char szBuffer[32];
+	if (fValue != fValue)
 	{
-		return SerializedValue("");
+		strcpy(szBuffer, "NAN");
 	}
-	String endString = m_strInput.substr(m_nIndex + utfStrLen, 2);
-	if (!endString.compare("\";") == 0)
+	else if (fValue > DBL_MAX)
 	{
-		return SerializedValue("");
+		strcpy(szBuffer, "INF");
 	}
-	m_nIndex = m_nIndex + utfStrLen + 2;
-	if (!isKey)
+	else if (fValue < -DBL_MAX)
 	{
-		m_arrRef.push_back(value);
+		strcpy(szBuffer, "-INF");
 	}
-	return value;
+	else
+	{
+		formatDouble(fValue, szBuffer, sizeof(szBuffer));
+	}
+	m_strOutput.append("d:", 2);
+	m_strOutput.append(szBuffer);
+	m_strOutput.push_back(';');
 }
 
-SerializedValue SerializedPhpParser::parseArray()
+void SerializedPhpWriter::writeString(const char* pData, int32 nLength)
 {
-	int32 arrayLen = readLength();
-	checkUnexpectedLength(arrayLen);
+	m_strOutput.append("s:", 2);
+	writeDecimal(nLength);
+	m_strOutput.append(":\"", 2);
+	m_strOutput.append(pData, nLength);
+	m_strOutput.append("\";", 2);
+}
 
-	SerializedValue result(arrayValue);
-	m_arrRef.push_back(result);
+void SerializedPhpWriter::writeArrayBegin(int32 nCount)
+{
+	m_strOutput.append("a:", 2);
+	writeDecimal(nCount);
+	m_strOutput.append(":{", 2);
+}
 
-	for (int i = 0; i < arrayLen; i++)
+void SerializedPhpWriter::writeObjectBegin(const char* pClassName, int32 nClassNameLength, int32 nCount)
+{
+	m_strOutput.append("O:", 2);
+	writeDecimal(nClassNameLength);
+	m_strOutput.append(":\"", 2);
+	m_strOutput.append(pClassName, nClassNameLength);
+	m_strOutput.append("\":", 2);
+	writeDecimal(nCount);
+	m_strOutput.append(":{", 2);
+}
+
+void SerializedPhpWriter::writeEnd()
+{
+	m_strOutput.push_back('}');
+}
+
+void SerializedPhpWriter::writeRaw(const char* pData, int32 nLength)
+{
+	m_strOutput.append(pData, nLength);
+}
+
+void SerializedPhpWriter::writeDecimal(int64 nValue)
+{
+	char szBuffer[24];
+	char* pEnd = szBuffer + sizeof(szBuffer);
+	char* p = pEnd;
+	uint64 nMagnitude = nValue < 0 ? 0 - uint64(nValue) : uint64(nValue);
+	do
 	{
-		const auto& key = parseInternal(true);
-		const auto& value = parseInternal(false);
-		if (isAcceptedAttribute(key))
-		{
-			if (key.isNumeric())
-			{
-				result[key.asInt()] = value;
-			}
-			else
-			{
-				result[key.asCString()] = value;
-			}
-		}
-	}
-	char endChar = m_strInput[m_nIndex];
-	if (endChar != '}')
+		*--p = char('0' + nMagnitude % 10);
+		nMagnitude /= 10;
+	} while (nMagnitude != 0);
+	if (nValue < 0)
 	{
-		return result;
+		*--p = '-';
 	}
-
-	m_nIndex++;
-	return result;
+	m_strOutput.append(p, pEnd - p);
 }
 
-SerializedValue SerializedPhpParser::parseObject()
+//////////////////////////////////////////////////////////////////////////
+
+
+SerializedInternTable::SerializedInternTable(uint32 nCapacity /*= 4096*/, uint32 nMaxLength /*= 32*/)
+	: m_nMaxLength(nMaxLength)
+	, m_nSize(0)
 {
-	SerializedValue result(objectValue);
-	m_arrRef.push_back(result);
+	uint32 nSlots = 16;
+	while (nSlots < nCapacity)
+	{
+		nSlots <<= 1;
+	}
+	m_nMask = nSlots - 1;
+	m_pSlots = new std::atomic<char*>[nSlots];
+	for (uint32 i = 0; i < nSlots; i++)
+	{
+		m_pSlots[i].store(0, std::memory_order_relaxed);
+	}
+}
 
-	int32 strLen = readLength();
-	checkUnexpectedLength(strLen);
-	String name = m_strInput.substr(m_nIndex, strLen);
-	m_nIndex = m_nIndex + strLen + 2;
-	int32 attrLen = readLength();
-	for (int32 i = 0; i < attrLen; i++)
+SerializedInternTable::~SerializedInternTable()
+{
+	for (uint32 i = 0; i <= m_nMask; i++)
 	{
-		const auto& key = parseInternal(true);
-		const auto& value = parseInternal(false);
-		if (isAcceptedAttribute(key))
+		char* pEntry = m_pSlots[i].load(std::memory_order_relaxed);
+		if (pEntry)
 		{
-			result[key.asCString()] = value;
+			::free(pEntry - 2 * sizeof(unsigned int));
 		}
 	}
-	m_nIndex++;
-	return result;
+	delete[] m_pSlots;
 }
 
-SerializedValue SerializedPhpParser::parseReference()
+uint32 SerializedInternTable::hash(const char* pData, uint32 nLength)
 {
-	int32 delimiter = m_strInput.find_first_of(';', m_nIndex);
-	if (delimiter == -1)
+	return hashStringValue(pData, nLength);
+}
+
+SerializedStaticString SerializedInternTable::find(const char* pData, uint32 nLength) const
+{
+	if (nLength > m_nMaxLength)
 	{
-		return SerializedValue(referenceValue);
+		return SerializedStaticString();
 	}
-	checkUnexpectedLength(delimiter + 1);
-	int32 refIndex = StringUtility::parseInt32(m_strInput.substr(m_nIndex, delimiter - m_nIndex)) - 1;
-	m_nIndex = delimiter + 1;
-	if ((refIndex + 1) > m_arrRef.size())
+	uint32 nHash = hash(pData, nLength);
+	for (uint32 i = nHash & m_nMask, nProbe = 0; nProbe <= m_nMask; i = (i + 1) & m_nMask, nProbe++)
 	{
-		return SerializedValue(referenceValue);
+		char* pEntry = m_pSlots[i].load(std::memory_order_acquire);
+		if (pEntry == 0)
+		{
+			break;
+		}
+		unsigned int header[2];
+		memcpy(header, pEntry - sizeof(header), sizeof(header));
+		if (header[0] == nHash
+			&& (header[1] & ~kStaticStringFlag) == nLength
+			&& memcmp(pEntry, pData, nLength) == 0)
+		{
+			return SerializedStaticString(pEntry);
+		}
 	}
-	auto value = m_arrRef[refIndex];
-	m_arrRef.push_back(value);
-	return value;
+	return SerializedStaticString();
 }
 
-bool SerializedPhpParser::checkUnexpectedLength(int32 newIndex)
+SerializedStaticString SerializedInternTable::intern(const char* pData, uint32 nLength)
 {
-	if (m_nIndex > m_nInputLenght || newIndex > m_nInputLenght)
+	if (nLength > m_nMaxLength)
 	{
-		return false;
+		return SerializedStaticString();
 	}
-	return true;
+	uint32 nHash = hash(pData, nLength);
+	char* pNew = 0;
+	for (uint32 i = nHash & m_nMask, nProbe = 0; nProbe <= m_nMask; i = (i + 1) & m_nMask, nProbe++)
+	{
+		char* pEntry = m_pSlots[i].load(std::memory_order_acquire);
+		if (pEntry == 0)
+		{
+			if (m_nSize.load(std::memory_order_relaxed) >= (m_nMask + 1) / 4 * 3)
+			{
+				break;
+			}
+			if (pNew == 0)
+			{
+				// [hash][length|static][chars]['\0'], SerializedValueַһ
+				unsigned int header[2] = { nHash, nLength | kStaticStringFlag };
+				char* pBlock = static_cast<char*>(::malloc(sizeof(header) + nLength + 1));
+				memcpy(pBlock, header, sizeof(header));
+				pNew = pBlock + sizeof(header);
+				memcpy(pNew, pData, nLength);
+				pNew[nLength] = 0;
+			}
+			if (m_pSlots[i].compare_exchange_strong(pEntry, pNew, std::memory_order_acq_rel, std::memory_order_acquire))
+			{
+				m_nSize.fetch_add(1, std::memory_order_relaxed);
+				return SerializedStaticString(pNew);
+			}
+			// ߳д, pEntryѸΪд, Ƚ
+		}
+		unsigned int header[2];
+		memcpy(header, pEntry - sizeof(header), sizeof(header));
+		if (header[0] == nHash
+			&& (header[1] & ~kStaticStringFlag) == nLength
+			&& memcmp(pEntry, pData, nLength) == 0)
+		{
+			if (pNew)
+			{
+				::free(pNew - sizeof(header));
+			}
+			return SerializedStaticString(pEntry);
+		}
+	}
+	if (pNew)
+	{
+		::free(pNew - 2 * sizeof(unsigned int));
+	}
+	return SerializedStaticString();
 }
@@ -12,6 +12,9 @@
 #ifndef __SerializedPhpParser_H__
 #define __SerializedPhpParser_H__
 
+#include <atomic>
+#include <unordered_set>
+
 
 //////////////////////////////////////////////////////////////////////////
 /// ֵ
@@ -25,12 +28,139 @@ enum SerializedValueType
 	booleanValue,	///< bool value
 	arrayValue,		///< array value (ordered list)
 	objectValue,	///< object value (collection of name/value pairs).
-	referenceValue	///< reference value
+	referenceValue,	///< reference value
+	customValue,	///< Serializable object (C:), payload kept undecoded
+	enumValue		///< enum case (E:)
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Կɼ
+//////////////////////////////////////////////////////////////////////////
+enum SerializedVisibility
+{
+	publicVisibility = 0,	///< "prop"
+	protectedVisibility,	///< "\0*\0prop"
+	privateVisibility		///< "\0Class\0prop"
+};
+
+/// , ͬһĵͬͬһ
+typedef std::shared_ptr<const String> SerializedClassName;
+
+//////////////////////////////////////////////////////////////////////////
+/// פַ, ֻSerializedInternTable, ʱָֻ
+//////////////////////////////////////////////////////////////////////////
+class SerializedStaticString
+{
+public:
+	SerializedStaticString() : str_(0) {}
+
+	const char* c_str() const { return str_; }
+	bool isNull() const { return str_ == 0; }
+
+private:
+	friend class SerializedInternTable;
+	explicit SerializedStaticString(const char* czstring) : str_(czstring) {}
+
+private:
+	const char* str_;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// 
+/// PHPһ, еĹ淶ʮ("5", "-3", "05"/"-0")תΪ,
+/// ַ, ֵַ֮ǰ.
+//////////////////////////////////////////////////////////////////////////
+class SerializedKey
+{
+public:
+	explicit SerializedKey(int64 index);
+	SerializedKey(const char* name);
+	SerializedKey(const String& name);
+	SerializedKey(const char* name, uint32 length,
+		SerializedVisibility visibility = publicVisibility, const SerializedClassName& scope = SerializedClassName());
+	SerializedKey(const SerializedStaticString& name,
+		SerializedVisibility visibility = publicVisibility, const SerializedClassName& scope = SerializedClassName());
+	SerializedKey(const SerializedKey& other);
+	~SerializedKey();
+
+	SerializedKey &operator=(const SerializedKey &other);
+
+	/// name()0, nameLength()0
+	const char* name() const { return name_; }
+	uint32 nameLength() const;
+	SerializedVisibility visibility() const { return visibility_; }
+
+	bool isInt() const { return name_ == 0; }
+	int64 intValue() const { return index_; }
+
+	/// ǷΪ淶ʮ, nIndexֵ
+	static bool parseInteger(const char* pData, uint32 nLength, int64& nIndex);
+
+	/// ˽Ե, Ϊ
+	const SerializedClassName& scope() const { return scope_; }
+
+	/// ԭΪлʽе
+	String mangledName() const;
+
+	/// ·Ƚ, ˳operator<ͬ
+	int compare(const SerializedKey &other) const;
+
+	bool operator <(const SerializedKey &other) const;
+	bool operator ==(const SerializedKey &other) const;
+	bool operator !=(const SerializedKey &other) const;
+
+	bool hasName(const char* name, uint32 length) const;
+	/// ͬ(ȽϿɼ)
+	bool hasSameName(const SerializedKey &other) const;
+
+private:
+	char* name_;				///< Ϊ0
+	int64 index_;
+	SerializedVisibility visibility_;
+	SerializedClassName scope_;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// ַפ
+/// ĵļ/ַȥر, , CAS.
+/// ڱǰһֱЧ, ˱ڱ볤ֵ.
+//////////////////////////////////////////////////////////////////////////
+class SerializedInternTable
+{
+public:
+	/// nCapacityȡΪ2, װس3/4ٲ
+	SerializedInternTable(uint32 nCapacity = 4096, uint32 nMaxLength = 32);
+	~SerializedInternTable();
+
+public:
+	/// һ, ʱؿմ
+	SerializedStaticString intern(const char* pData, uint32 nLength);
+
+	/// ֻҲ, Ԥȹõļ
+	SerializedStaticString find(const char* pData, uint32 nLength) const;
+
+	uint32 maxLength() const { return m_nMaxLength; }
+	uint32 size() const { return m_nSize.load(std::memory_order_relaxed); }
+
+private:
+	SerializedInternTable(const SerializedInternTable&);
+	SerializedInternTable& operator=(const SerializedInternTable&);
+
+	static uint32 hash(const char* pData, uint32 nLength);
+
+private:
+	std::atomic<char*>*		m_pSlots;
+	uint32					m_nMask;
+	uint32					m_nMaxLength;
+	std::atomic<uint32>		m_nSize;
 };
 
 //////////////////////////////////////////////////////////////////////////
 /// ֵ
 //////////////////////////////////////////////////////////////////////////
+class SerializedDocument;
+template<class Value> class SerializedMemberIterator;
+
 class SerializedValue
 {
 public:
@@ -47,7 +177,10 @@ public:
 	SerializedValue(const char *value);
 	SerializedValue(const char *beginValue, const char *endValue);
 	SerializedValue(const std::string& value);
+	SerializedValue(const SerializedStaticString& value);
 	SerializedValue(bool value);
+	/// customValue/enumValue:  + غ/ö
+	SerializedValue(SerializedValueType type, const char *beginValue, const char *endValue, const SerializedClassName& className);
 	SerializedValue(const SerializedValue& other);
 	~SerializedValue();
 
@@ -65,8 +198,14 @@ public:
 	bool operator ==(const SerializedValue &other) const;
 	bool operator !=(const SerializedValue &other) const;
 
+	/// ·Ƚ, һα: ȱ, ȱȳԱٰ˳Ƚϼֵ.
+	/// ȱȽ, operator==һ
 	int compare(const SerializedValue &other) const;
 
+	/// operator==һµĽṹϣ, ڹϣļ. ÿα,
+	/// ֻĵеfreeze()ʱ, SerializedDocument::hash()
+	uint64 hash() const;
+
 	SerializedValue& operator[](int32 index);
 	const SerializedValue& operator[](int32 index) const;
 
@@ -75,6 +214,21 @@ public:
 	SerializedValue& operator[](const std::string &key);
 	const SerializedValue& operator[](const std::string &key) const;
 
+	/// ļ(ɼ), פļʱֻȽָ
+	SerializedValue& operator[](const SerializedKey &key);
+	const SerializedValue& operator[](const SerializedKey &key) const;
+
+	/// , ֿɼ, Ҳ0Ҳ.
+	/// Ա϶һβʱϣ, ֻһιϣ
+	const SerializedValue* find(const char *key, uint32 length) const;
+	const SerializedValue* find(const char *key) const;
+	const SerializedValue* find(const std::string &key) const;
+#if __cplusplus >= 201703L
+	const SerializedValue* find(std::string_view key) const { return find(key.data(), uint32(key.length())); }
+#endif
+	/// ±, Ҳ0Ҳ
+	const SerializedValue* get(int64 index) const;
+
 public:
 	bool isNull() const;
 	bool isBool() const;
@@ -86,9 +240,15 @@ public:
 	bool isArray() const;
 	bool isObject() const;
 
+	bool isCustom() const;
+	bool isEnum() const;
+
 	const char *asCString() const;
 	std::string asString() const;
 
+	/// ַ/C:غ/öԭʼֽ, ɺ'\0'
+	bool getString(const char** begin, const char** end) const;
+
 	int32 asInt() const;
 	uint32 asUInt() const;
 	int64 asInt64() const;
@@ -105,46 +265,353 @@ public:
 
 	void clear();
 
+	/// Ľӿ, Աļõkey()ȡ
 	SerializedValue key() const;
 
 	uint32 index() const;
 
+	/// /C:/öٵ, ͬһĵͬͬһָ; 0
+	const char* className() const;
+	const SerializedClassName& classNameRef() const;
+	void setClassName(const SerializedClassName& className);
+
+public:
+	typedef std::map<SerializedKey, SerializedValue> ObjectValues;
+	typedef ObjectValues::value_type ObjectMember;
+	typedef SerializedMemberIterator<SerializedValue> iterator;
+	typedef SerializedMemberIterator<const SerializedValue> const_iterator;
+
+	/// /ĳԱ(), عĿձ
+	const ObjectValues& values() const;
+
+	/// ˳Ա, /ʱΪ; ³ԱʧЧ.
+	/// const汾ȸƹ, ȡõҪٸƱֵ
+	const_iterator begin() const;
+	const_iterator end() const;
+	iterator begin();
+	iterator end();
+
+	/// otherͬһ/ַ(ƺδ޸)
+	bool isSharedWith(const SerializedValue& other) const;
+
+	/// Ϊüֻĵ, ֻ֮ʲҲڴ
+	SerializedDocument freeze() const;
+
+	/// ֵռõĶڴֽ(16ֽ), ڵ㡢ַͼ.
+	/// /ַֻһ, פַ
+	size_t memoryUsage() const;
+
 private:
+	friend class SerializedDocument;
+
+	struct ObjectData;
+	struct NamedStringData;
+	struct KeyIndex;
+
+	/// ʱѷʹ/ַ, ùֻһ
+	typedef std::unordered_set<const void*> VisitedSet;
+
+	/// ȡûļ
+	const KeyIndex* buildIndex() const;
+	void buildIndexes(VisitedSet& visited) const;
+	size_t memoryUsage(VisitedSet& visited) const;
+	/// cachedΪtrueʱֱȡfreeze()ʱĹϣ
+	uint64 hashValue(bool cached) const;
+
 	SerializedValue& resolveReference(const char* key);
+	SerializedValue& insertMember(ObjectValues::iterator hint, const SerializedKey& key);
 
-public:
-	SerializedValueType type_;
+	ObjectValues& mutableValues();
+	ObjectData* mutableObject();
 
-	typedef std::map<String, SerializedValue> ObjectValues;
+	void setTag(SerializedValueType type, uint32 shortLength = 0);
+	void initString(const char* value, uint32 length);
+	void releasePayload();
+	bool isShortString() const;
+	const char* stringData(uint32& length) const;
+
+private:
+	enum
+	{
+		kShortStringCapacity = 14,	///< ַ󳤶, ֮'\0'
+		kTypeMask = 0x0F,			///< ֽڵ4λ: 
+		kLengthShift = 4,			///< ֽڸ4λ: ַ
+		kHeapString = 0x0F,			///< Ϊֵʱַڶ
+		kIndexThreshold = 16		///< Աﵽֵʱfindϣ
+	};
 
 	union ValueHolder
 	{
 		int64 int_;
 		double real_;
 		bool bool_;
-		char* string_;
-		ObjectValues *map_;
-	} value_;
+		char* string_;				///< ǰ׺Ķַ
+		ObjectData* object_;		///< /, Ϊ0
+		NamedStringData* named_;	///< customValue/enumValue
+	};
+
+	/// 16ֽ: ǰ8ֽΪֵַĿͷ, 1ֽΪͺ
+	union
+	{
+		ValueHolder value_;
+		char bytes_[16];
+	};
 };
 typedef std::vector<SerializedValue> SerializedValueArray;
 
+namespace std
+{
+	template<>
+	struct hash<SerializedValue>
+	{
+		size_t operator()(const SerializedValue& value) const { return size_t(value.hash()); }
+	};
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Ա
+/// ǰ, ˳(, ֵ), ʱڴ.
+//////////////////////////////////////////////////////////////////////////
+template<class Value>
+class SerializedMemberIterator
+{
+public:
+	typedef SerializedValue::ObjectMember Member;
+	typedef typename std::conditional<std::is_const<Value>::value, const Member, Member>::type MemberType;
+
+	typedef std::forward_iterator_tag iterator_category;
+	typedef Member value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef MemberType* pointer;
+	typedef MemberType& reference;
+
+public:
+	SerializedMemberIterator() : m_ppMember(0) {}
+	explicit SerializedMemberIterator(Member* const* ppMember) : m_ppMember(ppMember) {}
+
+	/// iteratorתΪconst_iterator
+	template<class Other>
+	SerializedMemberIterator(const SerializedMemberIterator<Other>& other,
+		typename std::enable_if<std::is_convertible<Other*, Value*>::value>::type* = 0)
+		: m_ppMember(other.base())
+	{
+	}
+
+public:
+	const SerializedKey& key() const { return (*m_ppMember)->first; }
+	Value& value() const { return (*m_ppMember)->second; }
+
+	reference operator*() const { return **m_ppMember; }
+	pointer operator->() const { return *m_ppMember; }
+
+	SerializedMemberIterator& operator++() { ++m_ppMember; return *this; }
+	SerializedMemberIterator operator++(int) { SerializedMemberIterator temp(*this); ++m_ppMember; return temp; }
+
+	bool operator==(const SerializedMemberIterator& other) const { return m_ppMember == other.m_ppMember; }
+	bool operator!=(const SerializedMemberIterator& other) const { return m_ppMember != other.m_ppMember; }
+
+	Member* const* base() const { return m_ppMember; }
+
+private:
+	Member* const* m_ppMember;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+/// ֻĵ
+/// SerializedValue::freeze(), ֻṩconst. ֻԭü,
+/// ̼߳䴫ݲ߳ͬʱȡ.
+/// ע: freeze֮ǰͨconst operator[]ȡõò޸.
+//////////////////////////////////////////////////////////////////////////
+class SerializedDocument
+{
+public:
+	SerializedDocument();
+
+public:
+	const SerializedValue& root() const { return *m_pRoot; }
+
+	const SerializedValue& operator[](int32 index) const { return (*m_pRoot)[index]; }
+	const SerializedValue& operator[](const char *key) const { return (*m_pRoot)[key]; }
+	const SerializedValue* find(const char *key, uint32 length) const { return m_pRoot->find(key, length); }
+	const SerializedValue* get(int64 index) const { return m_pRoot->get(index); }
+
+	SerializedValue::const_iterator begin() const { return m_pRoot->begin(); }
+	SerializedValue::const_iterator end() const { return m_pRoot->end(); }
+
+	bool isNull() const { return m_pRoot->isNull(); }
+
+	/// root().hash()ͬ, ֱʹfreeze()ʱõĸϣ
+	uint64 hash() const { return m_pRoot->hashValue(true); }
+
+private:
+	friend class SerializedValue;
+	explicit SerializedDocument(const std::shared_ptr<const SerializedValue>& pRoot);
+
+private:
+	std::shared_ptr<const SerializedValue> m_pRoot;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+/// лɨ
+/// ֱԭʼֽϰǰ׺ȡǺ, SerializedValue.
+//////////////////////////////////////////////////////////////////////////
+class SerializedPhpScanner
+{
+public:
+	enum
+	{
+		kMaxDepth = 4096	///< skipValueǶײ, PHPunserialize_max_depthĬֵͬ
+	};
+
+	SerializedPhpScanner(const char* pBegin, const char* pEnd);
+
+public:
+	bool eof() const { return m_pCurrent >= m_pEnd; }
+	char peek() const { return m_pCurrent < m_pEnd ? *m_pCurrent : 0; }
+	const char* current() const { return m_pCurrent; }
+	int32 offset() const { return int32(m_pCurrent - m_pBegin); }
+	int32 remaining() const { return int32(m_pEnd - m_pCurrent); }
+
+	bool expect(char ch);
+
+	/// ȡַ':', 'N'ͬ';'һȡ
+	bool readType(char& chType);
+
+	/// ȡchTerminatorβʮ
+	bool readInteger(int64& nValue, char chTerminator);
+	bool readDouble(double& fValue);
+
+	/// ¾readType֮
+	bool readString(const char*& pData, int32& nLength);
+	bool readArrayBegin(int32& nCount);
+	bool readObjectBegin(const char*& pClassName, int32& nClassNameLength, int32& nCount);
+	bool readEnd();
+
+	/// S:len:"\xx..."; ʽ, pValueΪ0ʱֻ
+	bool readEscapedString(String* pValue);
+
+	/// C:len:"Class":len:{payload}, غɰ
+	bool readCustom(const char*& pClassName, int32& nClassNameLength, const char*& pData, int32& nLength);
+
+	/// һֵ(ַ), Ƕ׳kMaxDepthʱfalse
+	bool skipValue();
+
+private:
+	bool skipValue(int32 nDepth);
+
+private:
+	const char*	m_pBegin;
+	const char*	m_pCurrent;
+	const char*	m_pEnd;
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+/// л
+/// ֱ׷PHPлʽļǺ.
+//////////////////////////////////////////////////////////////////////////
+class SerializedPhpWriter
+{
+public:
+	SerializedPhpWriter(String& strOutput);
+
+public:
+	String& output() { return m_strOutput; }
+
+	void writeNull();
+	void writeBool(bool bValue);
+	void writeInt(int64 nValue);
+	void writeDouble(double fValue);
+	void writeString(const char* pData, int32 nLength);
+	void writeArrayBegin(int32 nCount);
+	void writeObjectBegin(const char* pClassName, int32 nClassNameLength, int32 nCount);
+	void writeEnd();
+
+	/// ׷ѱõֽ, Ԥɵļǰ׺
+	void writeRaw(const char* pData, int32 nLength);
+
+	/// SERIALIZED_PHP_MAPPINGֶӳṹ, SerializedPhpMapping.h
+	template<class T>
+	void write(const T& value);
+
+	/// ޵ĸʽΪܻԭԭֵʮƱʾ(serialize_precision=-1һ), س
+	static int32 formatDouble(double fValue, char* szBuffer, int32 nSize);
+
+private:
+	void writeDecimal(int64 nValue);
+
+private:
+	String&		m_strOutput;
+};
+
+
+/// C:Ľ뺯, Ϊδغ
+typedef SerializedValue (*SerializedCustomHandler)(const char* pClassName, const char* pData, int32 nLength);
 
 //////////////////////////////////////////////////////////////////////////
 /// PHPл
 //////////////////////////////////////////////////////////////////////////
 class SerializedPhpParser
 {
+public:
+	/// עC:Ľ뺯, Ӧڽ֮ǰ(ʱ)ע
+	static void registerCustomHandler(const String& className, SerializedCustomHandler handler);
+
+	/// עĽ뺯C:غ, δעʱԭ
+	static SerializedValue decodeCustom(const SerializedValue& custom);
+
+	/// ֻǷΪϷл(ȡָԱñ), ֵҲڴ.
+	/// ϷʱpErrorOffsetسļǺеƫ
+	static bool validate(const char* pData, int32 nLength, int32* pErrorOffset = 0);
+	static bool validate(const String& strInput, int32* pErrorOffset = 0);
+
 public:
 	SerializedPhpParser(const String& strInput);
 	SerializedPhpParser(const String& strInput, bool bAssumeUTF8);
 	virtual ~SerializedPhpParser();
 
 public:
+	/// ͲpTable->maxLength()ַΪפ, 0ر
+	void setInternTable(SerializedInternTable* pTable);
+
+	/// igbinaryļͷͷ밴igbinary, SerializedPhpIgbinary.h(һͬSerializedPhpIgbinary.cpp);
+	/// igbinaryʧʱnull
 	SerializedValue parse();
 
+	/// ֲ, ÿεôԼnBudgetֽڵnBudgetֵ󷵻, ڰѴݷɢ¼ѭĶн.
+	/// ʱtrueresultؽ, ´μ; Ҫparse().
+	/// igbinaryڵһεʱ, parse()Ľͬ
+	bool parseStep(int32 nBudget, SerializedValue& result);
+
+	/// Ѵֽ
+	int32 offset() const { return m_nIndex; }
+
+	/// session.serialize_handler=php"name|value"ƴӵĸʽ, ΪԱΪ.
+	/// ñ, ıǰеֵ, session_decode()һ
+	SerializedValue parseSession();
+
+	/// ֻΪstrNameı, ; ĿֵǰеֵʱŽǰı.
+	/// ʱfalse
+	bool parseSessionVariable(const String& strName, SerializedValue& value);
+
+	/// SERIALIZED_PHP_MAPPINGֶӳֱṹ, SerializedPhpMapping.h
+	template<class T>
+	bool parseTo(T& object);
+
 private:
+	enum
+	{
+		kMaxValidateDepth = 4096	///< validateǶײ, PHPunserialize_max_depthĬֵͬ
+	};
+
 	void cleanup();
 
+	/// igbinaryļͷͷʱ뵽result(ʧʱΪnull)true
+	bool parseIgbinary(SerializedValue& result);
+
 	SerializedValue parseInternal(bool isKey);
 
 	SerializedValue parseInt(bool isKey);
@@ -153,14 +620,32 @@ private:
 	SerializedValue parseString(bool isKey);
 	SerializedValue parseArray();
 	SerializedValue parseObject();
-	SerializedValue parseReference();
+	SerializedValue parseReference(bool bValueReference);
+	SerializedValue parseEscapedString(bool isKey);
+	SerializedValue parseCustom();
+	SerializedValue parseEnum();
+
+	int32 beginArray(SerializedValue& result, size_t& nRefSlot);
+	/// ûнβ'}'ʱfalse
+	bool endArray(const SerializedValue& result, size_t nRefSlot);
+	int32 beginObject(SerializedValue& result, size_t& nRefSlot);
+	bool endObject(const SerializedValue& result, size_t nRefSlot);
+
+	SerializedKey parseKey(bool isProperty);
+	SerializedKey makeKey(const char* pName, int32 nLength, SerializedVisibility visibility, const SerializedClassName& scope);
+	SerializedClassName internClassName(const char* pName, int32 nLength);
 
 	int32 readLength();
+	bool readSessionName(const char*& pName, int32& nLength);
 
 	bool isAcceptedAttribute(const SerializedValue& key)
 	{
 		return true;
 	}
+	bool isAcceptedAttribute(const SerializedKey& key)
+	{
+		return true;
+	}
 
 private:
 	bool checkUnexpectedLength(int32 newIndex);
@@ -171,6 +656,21 @@ private:
 	bool		m_bAssumeUTF8;
 	int32		m_nIndex;
 	SerializedValueArray m_arrRef;
+	std::vector<SerializedClassName> m_arrClassNames;
+
+	/// parseStepδ/
+	struct PendingContainer
+	{
+		explicit PendingContainer(const SerializedKey& key) : key(key), nRemaining(0), nRefSlot(0), bObject(false) {}
+
+		SerializedValue value;
+		SerializedKey key;		///< һеļ
+		int32 nRemaining;
+		size_t nRefSlot;
+		bool bObject;
+	};
+	std::vector<PendingContainer> m_arrPending;
+	SerializedInternTable* m_pInternTable;
 };
 
 
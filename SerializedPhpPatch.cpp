@@ -0,0 +1,441 @@
+/**********************************************************************
+* Copyright (C) 2018 - tx7do - All Rights Reserved
+*
+* ļ:		SerializedPhpPatch.cpp
+* ժ    Ҫ:		ĵֱ޸леһֵ
+*
+*     :		yanglinbo,
+*     :		鿴ļ·.
+*
+***********************************************************************/
+
+#include "SerializedPhpPatch.h"
+
+
+// һֵۼռõñ(R:ÿֵռһ, ռ)
+static bool skipCounting(SerializedPhpScanner& scanner, int64& nSlots)
+{
+	char chType = 0;
+	if (!scanner.readType(chType))
+	{
+		return false;
+	}
+	if (chType != 'R')
+	{
+		nSlots++;
+	}
+
+	int64 nInt = 0;
+	double fReal = 0;
+	const char* pData = 0;
+	int32 nLength = 0;
+	int32 nCount = 0;
+	switch (chType)
+	{
+	case 'N':
+		return true;
+	case 'i':
+	case 'b':
+	case 'R':
+	case 'r':
+		return scanner.readInteger(nInt, ';');
+	case 'd':
+		return scanner.readDouble(fReal);
+	case 's':
+	case 'E':
+		return scanner.readString(pData, nLength);
+	case 'S':
+		return scanner.readEscapedString(0);
+	case 'C':
+		return scanner.readCustom(pData, nLength, pData, nLength);
+	case 'a':
+		if (!scanner.readArrayBegin(nCount))
+		{
+			return false;
+		}
+		break;
+	case 'O':
+		if (!scanner.readObjectBegin(pData, nLength, nCount))
+		{
+			return false;
+		}
+		break;
+	default:
+		return false;
+	}
+
+	for (int32 i = 0; i < nCount; i++)
+	{
+		if (!scanner.skipValue() || !skipCounting(scanner, nSlots))
+		{
+			return false;
+		}
+	}
+	return scanner.readEnd();
+}
+
+static void appendDecimal(String& strOutput, int64 nValue)
+{
+	char szBuffer[24];
+	strOutput.append(szBuffer, snprintf(szBuffer, sizeof(szBuffer), "%lld", (long long)nValue));
+}
+
+// ñŵĵ: [nInvalidBegin, nInvalidEnd)ڵıЧ, СnShiftFromıżnDelta
+struct SerializedRefShift
+{
+	int64 nInvalidBegin;
+	int64 nInvalidEnd;
+	int64 nShiftFrom;
+	int64 nDelta;
+};
+
+// [pBegin, pEnd)ǷR:/r:Ǻ; ַе"R:"Ҳ, ֻһcopyRebased
+static bool mayContainReference(const char* pBegin, const char* pEnd)
+{
+	for (const char* p = pBegin; p < pEnd; p++)
+	{
+		p = static_cast<const char*>(memchr(p, ':', pEnd - p));
+		if (p == 0)
+		{
+			return false;
+		}
+		if (p > pBegin && (p[-1] == 'R' || p[-1] == 'r'))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// ǺŸ[pBegin, pEnd), ֻдR:/r:ı, ֽθ
+static bool copyRebased(const char* pBegin, const char* pEnd, const SerializedRefShift& shift, String& strOutput)
+{
+	SerializedPhpScanner scanner(pBegin, pEnd);
+	const char* pCopied = pBegin;
+	while (!scanner.eof())
+	{
+		if (scanner.peek() == '}')
+		{
+			scanner.readEnd();
+			continue;
+		}
+		char chType = 0;
+		if (!scanner.readType(chType))
+		{
+			return false;
+		}
+		int64 nInt = 0;
+		double fReal = 0;
+		const char* pData = 0;
+		int32 nLength = 0;
+		int32 nCount = 0;
+		bool bResult = false;
+		switch (chType)
+		{
+		case 'N':
+			bResult = true;
+			break;
+		case 'i':
+		case 'b':
+			bResult = scanner.readInteger(nInt, ';');
+			break;
+		case 'R':
+		case 'r':
+		{
+			const char* pNumber = scanner.current();
+			if (!scanner.readInteger(nInt, ';'))
+			{
+				return false;
+			}
+			if (nInt >= shift.nInvalidBegin && nInt < shift.nInvalidEnd)
+			{
+				return false;
+			}
+			if (nInt >= shift.nShiftFrom)
+			{
+				strOutput.append(pCopied, pNumber - pCopied);
+				appendDecimal(strOutput, nInt + shift.nDelta);
+				strOutput.push_back(';');
+				pCopied = scanner.current();
+			}
+			bResult = true;
+		}
+		break;
+		case 'd':
+			bResult = scanner.readDouble(fReal);
+			break;
+		case 's':
+		case 'E':
+			bResult = scanner.readString(pData, nLength);
+			break;
+		case 'S':
+			bResult = scanner.readEscapedString(0);
+			break;
+		case 'C':
+			bResult = scanner.readCustom(pData, nLength, pData, nLength);
+			break;
+		case 'a':
+			bResult = scanner.readArrayBegin(nCount);
+			break;
+		case 'O':
+			bResult = scanner.readObjectBegin(pData, nLength, nCount);
+			break;
+		default:
+			break;
+		}
+		if (!bResult)
+		{
+			return false;
+		}
+	}
+	strOutput.append(pCopied, pEnd - pCopied);
+	return true;
+}
+
+// ·һļ, ԤñȽʽ, Ƚʱڴ
+struct SerializedPathKey
+{
+	explicit SerializedPathKey(const SerializedKey& key)
+		: key(key)
+		, bMangled(key.visibility() != publicVisibility)
+	{
+		if (bMangled)
+		{
+			strMangled = key.mangledName();
+		}
+	}
+
+	bool matchInt(int64 nKey) const
+	{
+		return !bMangled && key.isInt() && key.intValue() == nKey;
+	}
+
+	bool matchName(const char* pName, int32 nLength, bool bProperty) const
+	{
+		if (bMangled)
+		{
+			return bProperty && strMangled.length() == size_t(nLength) && memcmp(strMangled.data(), pName, nLength) == 0;
+		}
+		if (bProperty && nLength > 0 && pName[0] == '\0')
+		{
+			const char* pScopeEnd = static_cast<const char*>(memchr(pName + 1, '\0', nLength - 1));
+			if (pScopeEnd)
+			{
+				nLength -= int32(pScopeEnd + 1 - pName);
+				pName = pScopeEnd + 1;
+			}
+		}
+		int64 nKey = 0;
+		if (SerializedKey::parseInteger(pName, uint32(nLength), nKey))
+		{
+			return matchInt(nKey);
+		}
+		return key.hasName(pName, uint32(nLength));
+	}
+
+	const SerializedKey& key;
+	bool bMangled;
+	String strMangled;
+};
+
+// ·ҽ, Ϊеƫ
+struct SerializedPatchTarget
+{
+	bool bFound;
+	int32 nCountBegin;		///< һԱ
+	int32 nCountEnd;
+	int64 nCount;
+	bool bProperty;			///< һǶ
+	int32 nMemberBegin;		///< ĿԱļ, δҵʱΪ'}'λ
+	int32 nValueBegin;
+	int32 nValueEnd;
+	int64 nSlotBegin;		///< Ŀֵĵһñ, δҵʱΪ׷ӵֵõı
+	int64 nSlotCount;
+};
+
+static bool locate(const String& strInput, const std::vector<SerializedKey>& path, SerializedPatchTarget& target)
+{
+	const char* pInput = strInput.data();
+	SerializedPhpScanner scanner(pInput, pInput + strInput.length());
+	int64 nSlots = 0;
+	String strName;
+	memset(&target, 0, sizeof(target));
+
+	for (size_t nDepth = 0; nDepth < path.size(); nDepth++)
+	{
+		char chType = 0;
+		const char* pClassName = 0;
+		int32 nClassNameLength = 0;
+		int32 nCount = 0;
+		if (!scanner.readType(chType))
+		{
+			return false;
+		}
+		nSlots++;
+		bool bProperty = chType == 'O';
+		if (chType == 'a')
+		{
+			if (!scanner.readArrayBegin(nCount))
+				return false;
+		}
+		else if (bProperty)
+		{
+			if (!scanner.readObjectBegin(pClassName, nClassNameLength, nCount))
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+		// Ա":{"֮ǰ
+		target.nCountEnd = scanner.offset() - 2;
+		target.nCountBegin = target.nCountEnd;
+		while (target.nCountBegin > 0 && pInput[target.nCountBegin - 1] >= '0' && pInput[target.nCountBegin - 1] <= '9')
+		{
+			target.nCountBegin--;
+		}
+		target.nCount = nCount;
+		target.bProperty = bProperty;
+
+		SerializedPathKey key(path[nDepth]);
+		bool bLast = nDepth + 1 == path.size();
+		bool bMatched = false;
+		for (int32 i = 0; i < nCount && !bMatched; i++)
+		{
+			target.nMemberBegin = scanner.offset();
+			if (!scanner.readType(chType))
+			{
+				return false;
+			}
+			int64 nKey = 0;
+			const char* pName = 0;
+			int32 nLength = 0;
+			if (chType == 'i')
+			{
+				bMatched = scanner.readInteger(nKey, ';') && key.matchInt(nKey);
+			}
+			else if (chType == 's')
+			{
+				bMatched = scanner.readString(pName, nLength) && key.matchName(pName, nLength, bProperty);
+			}
+			else if (chType == 'S')
+			{
+				bMatched = scanner.readEscapedString(&strName) && key.matchName(strName.data(), int32(strName.length()), bProperty);
+			}
+			else
+			{
+				return false;
+			}
+			if (!bMatched && !skipCounting(scanner, nSlots))
+			{
+				return false;
+			}
+		}
+		if (!bMatched)
+		{
+			if (!bLast || scanner.peek() != '}')
+			{
+				return false;
+			}
+			target.nMemberBegin = scanner.offset();
+			target.nValueBegin = target.nValueEnd = scanner.offset();
+			target.nSlotBegin = nSlots + 1;
+			return true;
+		}
+	}
+
+	target.bFound = true;
+	target.nValueBegin = scanner.offset();
+	target.nSlotBegin = nSlots + 1;
+	if (!skipCounting(scanner, nSlots))
+	{
+		return false;
+	}
+	target.nValueEnd = scanner.offset();
+	target.nSlotCount = nSlots + 1 - target.nSlotBegin;
+	return path.size() > 0 || scanner.eof();
+}
+
+bool SerializedPhpPatch::set(const String& strInput, const std::vector<SerializedKey>& path, const String& strValue, String& strOutput)
+{
+	SerializedPatchTarget target;
+	if (!locate(strInput, path, target))
+	{
+		return false;
+	}
+	SerializedPhpScanner value(strValue.data(), strValue.data() + strValue.length());
+	int64 nValueSlots = 0;
+	if (!skipCounting(value, nValueSlots) || !value.eof())
+	{
+		return false;
+	}
+
+	const char* pInput = strInput.data();
+	strOutput.reserve(strOutput.length() + strInput.length() + strValue.length() + 32);
+	if (target.bFound)
+	{
+		strOutput.append(pInput, target.nValueBegin);
+	}
+	else
+	{
+		// ׷: Աһ, д'}'֮ǰ
+		strOutput.append(pInput, target.nCountBegin);
+		appendDecimal(strOutput, target.nCount + 1);
+		strOutput.append(pInput + target.nCountEnd, target.nMemberBegin - target.nCountEnd);
+		SerializedPhpWriter writer(strOutput);
+		const SerializedKey& key = path.back();
+		if (key.isInt())
+		{
+			writer.writeInt(key.intValue());
+		}
+		else
+		{
+			String strName = target.bProperty ? key.mangledName() : String(key.name(), key.nameLength());
+			writer.writeString(strName.data(), int32(strName.length()));
+		}
+	}
+
+	// ֵеôʼ, Ϊĵеı
+	SerializedRefShift valueShift = { 0, 1, 1, target.nSlotBegin - 1 };
+	if (!copyRebased(strValue.data(), strValue.data() + strValue.length(), valueShift, strOutput))
+	{
+		return false;
+	}
+
+	// ʱҲҪ: ֵ˱滻ֵʱܸд; ûʱθ
+	int64 nDelta = nValueSlots - target.nSlotCount;
+	const char* pTail = pInput + target.nValueEnd;
+	const char* pEnd = pInput + strInput.length();
+	if (!mayContainReference(pTail, pEnd))
+	{
+		strOutput.append(pTail, pEnd - pTail);
+		return true;
+	}
+	SerializedRefShift tailShift = { target.nSlotBegin, target.nSlotBegin + target.nSlotCount, target.nSlotBegin + target.nSlotCount, nDelta };
+	return copyRebased(pTail, pEnd, tailShift, strOutput);
+}
+
+bool SerializedPhpPatch::remove(const String& strInput, const std::vector<SerializedKey>& path, String& strOutput)
+{
+	SerializedPatchTarget target;
+	if (path.empty() || !locate(strInput, path, target) || !target.bFound)
+	{
+		return false;
+	}
+
+	const char* pInput = strInput.data();
+	strOutput.reserve(strOutput.length() + strInput.length());
+	strOutput.append(pInput, target.nCountBegin);
+	appendDecimal(strOutput, target.nCount - 1);
+	strOutput.append(pInput + target.nCountEnd, target.nMemberBegin - target.nCountEnd);
+
+	const char* pTail = pInput + target.nValueEnd;
+	const char* pEnd = pInput + strInput.length();
+	if (!mayContainReference(pTail, pEnd))
+	{
+		strOutput.append(pTail, pEnd - pTail);
+		return true;
+	}
+	SerializedRefShift tailShift = { target.nSlotBegin, target.nSlotBegin + target.nSlotCount, target.nSlotBegin + target.nSlotCount, -target.nSlotCount };
+	return copyRebased(pTail, pEnd, tailShift, strOutput);
+}
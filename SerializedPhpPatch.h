@@ -0,0 +1,38 @@
+/**********************************************************************
+* Copyright (C) 2018 - tx7do - All Rights Reserved
+*
+* ļ:		SerializedPhpPatch.h
+* ժ    Ҫ:		ĵֱ޸леһֵ
+*
+*     :		yanglinbo,
+*     :		鿴ļ·.
+*
+***********************************************************************/
+
+#ifndef __SerializedPhpPatch_H__
+#define __SerializedPhpPatch_H__
+
+#include "SerializedPhpParser.h"
+
+
+//////////////////////////////////////////////////////////////////////////
+/// ֲ޸
+/// ǰ׺޹صֵҵ·, ֻ滻ĿֵֽڲĳԱ,
+/// ֽԭ. ·ϵļƥ, ԵĿɼ(find()һ),
+/// ָ˱/˽пɼԵļƥ.
+/// Ŀǰֵĸͬʱ, R:/r:ñ֮; ָ滻ɾֵʱʧ.
+/// ʧʱstrOutput׷ӵݲ.
+//////////////////////////////////////////////////////////////////////////
+class SerializedPhpPatch
+{
+public:
+	/// pathֵָ滻ΪstrValue(һлֵ, еôstrValueʼ),
+	/// һļʱ׷ӵ/ĩβ. pathΪʱ滻ĵ
+	static bool set(const String& strInput, const std::vector<SerializedKey>& path, const String& strValue, String& strOutput);
+
+	/// ɾpathָĳԱ, ʱfalse
+	static bool remove(const String& strInput, const std::vector<SerializedKey>& path, String& strOutput);
+};
+
+
+#endif
@@ -0,0 +1,373 @@
+/**********************************************************************
+* Copyright (C) 2018 - tx7do - All Rights Reserved
+*
+* ļ:		SerializedPhpTest.cpp
+* ժ    Ҫ:		ع, Դļһɶĳ, ʧʱط0
+*
+*     :		yanglinbo,
+*     :		鿴ļ·.
+*
+***********************************************************************/
+
+#include "../SerializedPhpParser.h"
+#include "../SerializedPhpMapping.h"
+#include "../SerializedPhpColumns.h"
+#include "../SerializedPhpPatch.h"
+#include "../SerializedPhpJson.h"
+#include "../SerializedPhpIgbinary.h"
+
+
+static int32 g_nFailures = 0;
+
+#define SERIALIZED_CHECK(expr) \
+	do \
+	{ \
+		if (!(expr)) \
+		{ \
+			printf("%s:%d: %s\n", __FILE__, __LINE__, #expr); \
+			g_nFailures++; \
+		} \
+	} while (0)
+
+static SerializedValue parseText(const char* pInput)
+{
+	SerializedPhpParser parser(pInput);
+	return parser.parse();
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// ñ: ÿֵռһ(1ʼ), R:ռ, r:ռ
+//////////////////////////////////////////////////////////////////////////
+static void testReferenceNumbering()
+{
+	// R:ռ, ֮r:3ָ"z"
+	SerializedValue value = parseText("a:4:{i:0;s:1:\"x\";i:1;R:2;i:2;s:1:\"z\";i:3;r:3;}");
+	SERIALIZED_CHECK(value[1].asString() == "x");
+	SERIALIZED_CHECK(value[3].asString() == "z");
+
+	// r:ռ
+	value = parseText("a:4:{i:0;s:1:\"x\";i:1;r:2;i:2;s:1:\"z\";i:3;r:4;}");
+	SERIALIZED_CHECK(value[3].asString() == "z");
+
+	// öռһ, ʽöҲ
+	value = parseText("a:3:{i:0;E:11:\"Suit:Hearts\";i:1;s:1:\"x\";i:2;r:3;}");
+	SERIALIZED_CHECK(value[0].isEnum());
+	SERIALIZED_CHECK(value[2].asString() == "x");
+	value = parseText("a:3:{i:0;E:5:\"SuitH\";i:1;s:1:\"x\";i:2;r:3;}");
+	SERIALIZED_CHECK(value[2].asString() == "x");
+
+	// 0ͳΧıЧ
+	const char* arrInvalid[] =
+	{
+		"a:2:{i:0;s:1:\"x\";i:1;R:0;}",
+		"a:2:{i:0;s:1:\"x\";i:1;r:0;}",
+		"a:2:{i:0;s:1:\"x\";i:1;R:-1;}",
+		"a:2:{i:0;s:1:\"x\";i:1;r:-5;}",
+		"a:2:{i:0;s:1:\"x\";i:1;R:9;}",
+	};
+	for (size_t i = 0; i < sizeof(arrInvalid) / sizeof(arrInvalid[0]); i++)
+	{
+		value = parseText(arrInvalid[i]);
+		SERIALIZED_CHECK(value[1].type() == referenceValue);
+		SERIALIZED_CHECK(!SerializedPhpParser::validate(arrInvalid[i], int32(strlen(arrInvalid[i]))));
+	}
+
+	// sessionı
+	String strSession("a|a:2:{i:0;s:1:\"x\";i:1;R:2;}b|s:1:\"y\";c|R:3;");
+	SerializedPhpParser parser(strSession);
+	value = parser.parseSession();
+	SERIALIZED_CHECK(value["c"].asString() == "y");
+	SerializedPhpParser variableParser(strSession);
+	SerializedValue variable;
+	SERIALIZED_CHECK(variableParser.parseSessionVariable("c", variable));
+	SERIALIZED_CHECK(variable.asString() == "y");
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// ضϵ: Խȡ, û'}'Ϊnull, parseparseStepͬ
+//////////////////////////////////////////////////////////////////////////
+static void testTruncatedInput()
+{
+	const char* arrInputs[] =
+	{
+		"a:1:{i:0;i:1;",
+		"O:3:\"Foo\":1:{s:1:\"a\";i:1;",
+		"O:30:\"Foo",
+		"a:1:{s:-5:\"",
+		"a:2:{i:0;a:1:{i:0;N;}",
+		"a:1:",
+	};
+	for (size_t i = 0; i < sizeof(arrInputs) / sizeof(arrInputs[0]); i++)
+	{
+		SERIALIZED_CHECK(parseText(arrInputs[i]).isNull());
+		SerializedPhpParser parser(arrInputs[i]);
+		SerializedValue result;
+		while (!parser.parseStep(3, result))
+		{
+		}
+		SERIALIZED_CHECK(result.isNull());
+	}
+	SERIALIZED_CHECK(parseText("a:1:{i:0;i:1;}")[0].asInt() == 1);
+
+	// Աܴ󵫲ʱ, ÿparseStepĹ
+	SerializedPhpParser parser("a:2000000000:{}");
+	SerializedValue result;
+	int32 nCalls = 0;
+	while (!parser.parseStep(1000, result) && nCalls < 100)
+	{
+		nCalls++;
+	}
+	SERIALIZED_CHECK(nCalls < 100);
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// פ: ʽַͼפ
+//////////////////////////////////////////////////////////////////////////
+static void testInternMalformed()
+{
+	SerializedInternTable table;
+	const char* arrInputs[] =
+	{
+		"s:5:\"abc",
+		"s:3:\"abcXY",
+		"a:1:{s:3:\"key",
+		"a:1:{s:3:\"keyXXi:1;}",
+	};
+	for (size_t i = 0; i < sizeof(arrInputs) / sizeof(arrInputs[0]); i++)
+	{
+		SerializedPhpParser parser(arrInputs[i]);
+		parser.setInternTable(&table);
+		parser.parse();
+	}
+	SERIALIZED_CHECK(table.size() == 0);
+
+	SerializedPhpParser parser("a:1:{s:3:\"key\";s:3:\"abc\";}");
+	parser.setInternTable(&table);
+	SERIALIZED_CHECK(parser.parse()["key"].asString() == "abc");
+	SERIALIZED_CHECK(table.size() == 2);
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// У: ΧĳȡԱܾ
+//////////////////////////////////////////////////////////////////////////
+static void testValidateRejects()
+{
+	const char* arrInvalid[] =
+	{
+		"a:4294967297:{}",
+		"a:-1:{}",
+		"i:99999999999999999999999;",
+		"i:9223372036854775808;",
+		"s:9223372036854775807:\"x\";",
+		"s:4294967297:\"x\";",
+		"s:2:\"x\";",
+		"a:1:{i:0;i:1;",
+		"O:1:\"A\":1:{s:1:\"a\";i:1;",
+	};
+	for (size_t i = 0; i < sizeof(arrInvalid) / sizeof(arrInvalid[0]); i++)
+	{
+		SERIALIZED_CHECK(!SerializedPhpParser::validate(arrInvalid[i], int32(strlen(arrInvalid[i]))));
+	}
+	SERIALIZED_CHECK(SerializedPhpParser::validate(String("i:-9223372036854775808;")));
+	SERIALIZED_CHECK(SerializedPhpParser::validate(String("a:1:{i:0;O:1:\"A\":1:{s:1:\"a\";i:1;}}")));
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// ֲ޸: Ŀ֮ñֵĸ
+//////////////////////////////////////////////////////////////////////////
+static void testPatchReferences()
+{
+	std::vector<SerializedKey> path;
+	path.push_back(SerializedKey(int64(0)));
+
+	// ֵ滻Ϊһ, ֮R:4ΪR:3
+	String strOutput;
+	SERIALIZED_CHECK(SerializedPhpPatch::set("a:3:{i:0;a:1:{i:0;i:1;}i:1;s:1:\"x\";i:2;R:4;}", path, "i:9;", strOutput));
+	SERIALIZED_CHECK(strOutput == "a:3:{i:0;i:9;i:1;s:1:\"x\";i:2;R:3;}");
+	SERIALIZED_CHECK(parseText(strOutput.c_str())[2].asString() == "x");
+
+	strOutput.clear();
+	SERIALIZED_CHECK(SerializedPhpPatch::remove("a:3:{i:0;a:1:{i:0;i:1;}i:1;s:1:\"x\";i:2;R:4;}", path, strOutput));
+	SERIALIZED_CHECK(strOutput == "a:2:{i:1;s:1:\"x\";i:2;R:2;}");
+
+	// ûõĲԭ
+	strOutput.clear();
+	SERIALIZED_CHECK(SerializedPhpPatch::set("a:2:{i:0;i:1;i:1;s:1:\"x\";}", path, "a:1:{i:0;i:1;}", strOutput));
+	SERIALIZED_CHECK(strOutput == "a:2:{i:0;a:1:{i:0;i:1;}i:1;s:1:\"x\";}");
+
+	// ָ滻ֵʱʧ
+	strOutput.clear();
+	SERIALIZED_CHECK(!SerializedPhpPatch::set("a:2:{i:0;a:1:{i:0;i:1;}i:1;R:3;}", path, "i:9;", strOutput));
+	strOutput.clear();
+	SERIALIZED_CHECK(!SerializedPhpPatch::set("a:2:{i:0;i:1;i:1;R:2;}", path, "a:1:{i:0;i:1;}", strOutput));
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// JSON: Ϊ0..n-1Ϊб, Ϊ; չ
+//////////////////////////////////////////////////////////////////////////
+static void testJsonLists()
+{
+	const char* arrCases[][2] =
+	{
+		{ "a:0:{}", "[]" },
+		{ "a:2:{i:0;i:1;i:1;i:2;}", "[1,2]" },
+		{ "a:2:{i:1;i:1;i:0;i:2;}", "{\"1\":1,\"0\":2}" },
+		// б;ֲļʱΪ, ָ֮ȷֵ
+		{ "a:3:{i:0;s:1:\"a\";i:1;a:1:{i:0;i:5;}i:5;R:3;}", "{\"0\":\"a\",\"1\":[5],\"5\":[5]}" },
+		{ "a:2:{i:0;a:2:{i:0;i:1;s:1:\"k\";i:2;}i:1;R:2;}", "[{\"0\":1,\"k\":2},{\"0\":1,\"k\":2}]" },
+		{ "a:2:{i:0;a:3:{i:0;s:1:\"a\";i:1;R:3;s:1:\"k\";i:2;}i:1;R:3;}", "[{\"0\":\"a\",\"1\":\"a\",\"k\":2},\"a\"]" },
+	};
+	for (size_t i = 0; i < sizeof(arrCases) / sizeof(arrCases[0]); i++)
+	{
+		String strOutput;
+		SERIALIZED_CHECK(SerializedPhpJson::toJson(String(arrCases[i][0]), strOutput));
+		SERIALIZED_CHECK(strOutput == arrCases[i][1]);
+
+		String strValue;
+		SerializedPhpJson::toJson(parseText(arrCases[i][0]), strValue);
+		SERIALIZED_CHECK(strValue == arrCases[i][1]);
+	}
+
+	// ÿһ, չΪ2^30Ԫ
+	String strInput("a:31:{i:0;a:1:{i:0;s:1:\"x\";}");
+	char szItem[64];
+	for (int32 i = 1; i <= 30; i++)
+	{
+		int32 nPrevious = i == 1 ? 2 : i + 2;
+		snprintf(szItem, sizeof(szItem), "i:%d;a:2:{i:0;R:%d;i:1;R:%d;}", i, nPrevious, nPrevious);
+		strInput += szItem;
+	}
+	strInput += "}";
+	String strOutput;
+	SERIALIZED_CHECK(!SerializedPhpJson::toJson(strInput, strOutput));
+	SERIALIZED_CHECK(strOutput.length() <= (1 << 20));
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// igbinary: õֵͬ
+//////////////////////////////////////////////////////////////////////////
+static void testIgbinaryRoundTrip()
+{
+	const char* arrInputs[] =
+	{
+		"N;",
+		"b:1;",
+		"i:-9223372036854775808;",
+		"i:300;",
+		"d:0.5;",
+		"s:0:\"\";",
+		"a:0:{}",
+		"a:3:{i:0;s:3:\"abc\";s:3:\"abc\";s:3:\"abc\";i:-1;a:1:{i:0;d:-2.25;}}",
+		"a:2:{i:0;O:1:\"A\":0:{}i:1;O:1:\"B\":0:{}}",
+	};
+	std::vector<String> arrValues(arrInputs, arrInputs + sizeof(arrInputs) / sizeof(arrInputs[0]));
+	// Եļ'\0'
+	arrValues.push_back(String("O:3:\"Foo\":2:{s:1:\"a\";i:1;s:4:\"\0*\0b\";O:3:\"Foo\":0:{}}", 51));
+	for (size_t i = 0; i < arrValues.size(); i++)
+	{
+		SerializedPhpParser parser(arrValues[i]);
+		SerializedValue value = parser.parse();
+		SERIALIZED_CHECK(!value.isNull() || arrValues[i] == "N;");
+		String strEncoded;
+		SERIALIZED_CHECK(SerializedPhpIgbinary::encode(value, strEncoded));
+		SERIALIZED_CHECK(SerializedPhpIgbinary::isIgbinary(strEncoded.data(), int32(strEncoded.length())));
+		SerializedValue decoded;
+		SERIALIZED_CHECK(SerializedPhpIgbinary::decode(strEncoded.data(), int32(strEncoded.length()), decoded));
+		SERIALIZED_CHECK(decoded == value);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// Ƚϣ: Ƚ, ͬĶ
+//////////////////////////////////////////////////////////////////////////
+static void testObjectClassName()
+{
+	SerializedValue first = parseText("O:1:\"A\":1:{s:1:\"x\";i:1;}");
+	SerializedValue second = parseText("O:1:\"B\":1:{s:1:\"x\";i:1;}");
+	SerializedValue same = parseText("O:1:\"A\":1:{s:1:\"x\";i:1;}");
+	SERIALIZED_CHECK(first != second);
+	SERIALIZED_CHECK(first.compare(second) < 0 && second.compare(first) > 0);
+	SERIALIZED_CHECK(first.hash() != second.hash());
+	SERIALIZED_CHECK(first == same && first.compare(same) == 0 && first.hash() == same.hash());
+	SERIALIZED_CHECK(parseText("O:1:\"A\":0:{}") != parseText("O:1:\"B\":0:{}"));
+
+	SerializedDocument document = parseText("O:1:\"A\":0:{}").freeze();
+	SerializedDocument otherDocument = parseText("O:1:\"B\":0:{}").freeze();
+	SERIALIZED_CHECK(document.hash() != otherDocument.hash());
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// н: вκֵ
+//////////////////////////////////////////////////////////////////////////
+static void testColumnsFailedRow()
+{
+	// ڶдidnamescore
+	String strInput("a:2:{i:0;a:2:{s:2:\"id\";i:1;s:4:\"name\";s:1:\"a\";}"
+		"i:1;a:3:{s:2:\"id\";i:2;s:4:\"name\";s:2:\"bb\";s:5:\"score\";d:x;}}");
+	SerializedPhpColumns columns;
+	SERIALIZED_CHECK(!columns.parse(strInput));
+	SERIALIZED_CHECK(columns.rows() == 1);
+	SERIALIZED_CHECK(columns.columns() == 2);
+	const SerializedColumn* pId = columns.find("id");
+	const SerializedColumn* pName = columns.find("name");
+	SERIALIZED_CHECK(pId && pId->isValid(0) && pId->ints()[0] == 1 && pId->validity()[0] == 1);
+	SERIALIZED_CHECK(pName && pName->offsets()[1] == 1 && String(pName->bytes(), 1) == "a");
+	SERIALIZED_CHECK(pName && pName->validity()[0] == 1);
+
+	// һоͳʱ, һоҲ
+	SerializedPhpColumns declared;
+	declared.addColumn("id");
+	SERIALIZED_CHECK(!declared.parse("a:1:{i:0;a:2:{s:2:\"id\";s:1:\"x\";s:1:\"y\";i:}}"));
+	SERIALIZED_CHECK(declared.rows() == 0);
+	SERIALIZED_CHECK(declared.find("id")->type() == nullValue);
+	SERIALIZED_CHECK(declared.find("id")->bytes()[0] == '\0');
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// ṹӳ: vectorֻܼΪ0..n-1
+//////////////////////////////////////////////////////////////////////////
+struct SerializedTestList
+{
+	std::vector<int32> items;
+};
+SERIALIZED_PHP_MAPPING_BEGIN(SerializedTestList)
+	SERIALIZED_PHP_FIELD(items)
+SERIALIZED_PHP_MAPPING_END()
+
+static void testMappingVector()
+{
+	SerializedTestList list;
+	SerializedPhpParser parser("a:1:{s:5:\"items\";a:2:{i:0;i:5;i:1;i:7;}}");
+	SERIALIZED_CHECK(parser.parseTo(list));
+	SERIALIZED_CHECK(list.items.size() == 2 && list.items[0] == 5 && list.items[1] == 7);
+
+	const char* arrInvalid[] =
+	{
+		"a:1:{s:5:\"items\";a:2:{i:5;i:1;s:1:\"x\";i:2;}}",
+		"a:1:{s:5:\"items\";a:2:{i:1;i:1;i:0;i:2;}}",
+		"a:1:{s:5:\"items\";a:4294967297:{i:0;i:1;}}",
+	};
+	for (size_t i = 0; i < sizeof(arrInvalid) / sizeof(arrInvalid[0]); i++)
+	{
+		SerializedTestList invalid;
+		SerializedPhpParser invalidParser(arrInvalid[i]);
+		SERIALIZED_CHECK(!invalidParser.parseTo(invalid));
+	}
+}
+
+int main()
+{
+	testReferenceNumbering();
+	testTruncatedInput();
+	testInternMalformed();
+	testValidateRejects();
+	testPatchReferences();
+	testJsonLists();
+	testIgbinaryRoundTrip();
+	testObjectClassName();
+	testColumnsFailedRow();
+	testMappingVector();
+
+	printf("%d failure(s)\n", g_nFailures);
+	return g_nFailures ? 1 : 0;
+}